@@ -0,0 +1,285 @@
+#include "Interpreter.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// Benchmark harness: times lexing, parsing and execution of every script in the corpus
+// separately, over repeated runs, and reports the median and standard deviation of each.
+// Parsing includes the lexing it starts with, execution excludes loading the script.
+// Results can be saved as JSON and later runs compared against them:
+//   bench --save=baseline.json
+//   (make a change)
+//   bench --baseline=baseline.json
+// A phase counts as slower or faster when its median moved by more than 5% and by more
+// than twice the combined deviation. The exit status is 1 if anything got slower.
+
+static const char *PHASES[] = {"lex", "parse", "exec"};
+static const int PHASE_COUNT = 3;
+
+class Stats {
+public:
+    double median = 0;
+    double deviation = 0;
+};
+
+class Result {
+public:
+    string name;
+    Stats phases[PHASE_COUNT];
+};
+
+static void error(const string &message, const string &extra = "") {
+    cerr << "[Bench] [Error]: " << message << extra << endl;
+    exit(-1);
+}
+
+static Stats summarize(vector<double> times) {
+    Stats stats;
+    sort(times.begin(), times.end());
+    size_t n = times.size();
+    stats.median = n % 2 == 1 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+    double mean = 0;
+    for (double t : times) mean += t;
+    mean /= n;
+    double variance = 0;
+    for (double t : times) variance += (t - mean) * (t - mean);
+    stats.deviation = n > 1 ? sqrt(variance / (n - 1)) : 0;
+    return stats;
+}
+
+template<typename F>
+static double measure(F body) {
+    auto start = chrono::steady_clock::now();
+    body();
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// A large script that does little at run time, for lexer and parser throughput.
+static string generateSource(const string &directory) {
+    string filename = directory + "/generated.js";
+    ofstream out(filename);
+    for (int i = 0; i < 4000; ++i) {
+        out << "function f" << i << "(a, b) {\n"
+            << "    let x = a * 3 + b - " << i << ";\n"
+            << "    if (x > 10) {\n"
+            << "        x = x - 1;\n"
+            << "    } else {\n"
+            << "        x = x + 2.5;\n"
+            << "    }\n"
+            << "    for (let i = 0; i < 3; i = i + 1) {\n"
+            << "        x = x + i;\n"
+            << "    }\n"
+            << "    let s = \"name " << i << "\";\n"
+            << "    return x;\n"
+            << "}\n"
+            << "let r" << i << " = f" << i << "(" << i << ", 7);\n";
+    }
+    if (!out) error("cannot write generated source: ", filename);
+    return filename;
+}
+
+class Options {
+public:
+    int runs = 10;
+    string engine = "ast";
+    int optimizationLevel = 1;
+    int jitThreshold = 0;
+};
+
+// Script output and the variable table go to /dev/null while the script runs.
+static double execute(string &filename, const Options &options) {
+    Interpreter interpreter;
+    interpreter.setEngine(options.engine == "vm" ? Interpreter::BYTECODE_VM : Interpreter::TREE_WALKER);
+    interpreter.setOptimizationLevel(options.optimizationLevel);
+    interpreter.setJit(options.jitThreshold);
+    interpreter.loadFile(filename);
+    cout.flush();
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+    double elapsed = measure([&] {
+        interpreter.run();
+        cout.flush();
+        fflush(stdout);
+    });
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    return elapsed;
+}
+
+static Result benchmark(const string &name, string filename, const Options &options) {
+    vector<double> times[PHASE_COUNT];
+    for (int run = 0; run <= options.runs; ++run) { // The first run only warms up.
+        double lex = measure([&] {
+            Lexer lexer;
+            lexer.openFile(filename);
+            while (lexer.nextToken().type != Lexer::END_OF_FILE) {}
+        });
+        double parse = measure([&] {
+            Parser parser;
+            parser.parseFile(filename);
+        });
+        double exec = execute(filename, options);
+        if (run == 0) continue;
+        times[0].push_back(lex);
+        times[1].push_back(parse);
+        times[2].push_back(exec);
+    }
+    Result result;
+    result.name = name;
+    for (int i = 0; i < PHASE_COUNT; ++i) result.phases[i] = summarize(times[i]);
+    return result;
+}
+
+static void save(const string &filename, const vector<Result> &results, const Options &options) {
+    ofstream out(filename);
+    out << "{\n  \"engine\": \"" << options.engine << "\",\n  \"jit\": " << options.jitThreshold
+        << ",\n  \"runs\": " << options.runs << ",\n"
+        << "  \"benchmarks\": {\n";
+    out << fixed << setprecision(4);
+    for (size_t i = 0; i < results.size(); ++i) {
+        out << "    \"" << results[i].name << "\": {";
+        for (int j = 0; j < PHASE_COUNT; ++j) {
+            const Stats &stats = results[i].phases[j];
+            out << (j > 0 ? ", " : "") << "\"" << PHASES[j] << "\": {\"median\": " << stats.median
+                << ", \"deviation\": " << stats.deviation << "}";
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  }\n}\n";
+    if (!out) error("cannot write results: ", filename);
+}
+
+// Read the numbers of a JSON file as dotted paths, "benchmarks.fib.exec.median" for
+// instance. Only as much JSON as save() writes is understood.
+static map<string, double> load(const string &filename) {
+    ifstream in(filename);
+    if (!in) error("cannot read baseline: ", filename);
+    stringstream buffer;
+    buffer << in.rdbuf();
+    string text = buffer.str();
+    map<string, double> values;
+    vector<string> path;
+    string key;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '"') {
+            size_t end = text.find('"', i + 1);
+            if (end == string::npos) error("unterminated string in ", filename);
+            key = text.substr(i + 1, end - i - 1);
+            i = end;
+        } else if (c == '{') {
+            if (!key.empty() || !path.empty()) path.push_back(key);
+            key.clear();
+        } else if (c == '}') {
+            if (!path.empty()) path.pop_back();
+            key.clear();
+        } else if (c == '-' || isdigit(c)) {
+            size_t length;
+            double value = stod(text.substr(i), &length);
+            string name;
+            for (const string &part : path) name += part + ".";
+            values[name + key] = value;
+            i += length - 1;
+            key.clear();
+        } else if (c == ',') {
+            key.clear();
+        }
+    }
+    return values;
+}
+
+// Print the results, compared to the baseline if there is one. Returns whether anything got slower.
+static bool report(const vector<Result> &results, const map<string, double> &baseline) {
+    bool slower = false;
+    cout << left << setw(12) << "benchmark" << setw(7) << "phase" << right << setw(12) << "median ms"
+         << setw(12) << "deviation";
+    if (!baseline.empty()) cout << setw(12) << "baseline" << setw(10) << "change";
+    cout << endl << fixed;
+    for (const Result &result : results) {
+        for (int i = 0; i < PHASE_COUNT; ++i) {
+            const Stats &stats = result.phases[i];
+            cout << left << setw(12) << result.name << setw(7) << PHASES[i] << right << setprecision(3)
+                 << setw(12) << stats.median << setw(12) << stats.deviation;
+            string prefix = "benchmarks." + result.name + "." + PHASES[i] + ".";
+            auto median = baseline.find(prefix + "median");
+            auto deviation = baseline.find(prefix + "deviation");
+            if (median != baseline.end() && deviation != baseline.end() && median->second > 0) {
+                double change = stats.median / median->second - 1;
+                double noise = 2 * sqrt(stats.deviation * stats.deviation + deviation->second * deviation->second);
+                bool significant = fabs(change) > 0.05 && fabs(stats.median - median->second) > noise;
+                cout << setw(12) << median->second << setw(9) << setprecision(1) << showpos << change * 100
+                     << "%" << noshowpos;
+                if (significant) cout << (change > 0 ? "  slower" : "  faster");
+                slower = slower || (significant && change > 0);
+            }
+            cout << endl;
+        }
+    }
+    return slower;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    string corpus = BENCH_DIRECTORY;
+    string saveFile;
+    string baselineFile;
+    vector<string> selected;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--runs=", 7) == 0) {
+            options.runs = atoi(argv[i] + 7);
+        } else if (strcmp(argv[i], "--engine=vm") == 0 || strcmp(argv[i], "--engine=ast") == 0) {
+            options.engine = argv[i] + 9;
+        } else if (strcmp(argv[i], "-O0") == 0 || strcmp(argv[i], "-O1") == 0) {
+            options.optimizationLevel = argv[i][2] - '0';
+        } else if (strcmp(argv[i], "--jit") == 0) {
+            options.jitThreshold = 100;
+        } else if (strncmp(argv[i], "--corpus=", 9) == 0) {
+            corpus = argv[i] + 9;
+        } else if (strncmp(argv[i], "--save=", 7) == 0) {
+            saveFile = argv[i] + 7;
+        } else if (strncmp(argv[i], "--baseline=", 11) == 0) {
+            baselineFile = argv[i] + 11;
+        } else if (argv[i][0] != '-') {
+            selected.push_back(argv[i]);
+        } else {
+            cerr << "usage: " << argv[0] << " [--runs=<n>] [--engine=ast|vm] [-O0|-O1] [--jit] [--corpus=<dir>]"
+                 << " [--save=<json>] [--baseline=<json>] [<benchmark>...]" << endl;
+            exit(-1);
+        }
+    }
+    if (options.runs < 1) error("need at least one run");
+    map<string, string> scripts; // Sorted by name.
+    for (const auto &entry : filesystem::directory_iterator(corpus)) {
+        if (entry.path().extension() == ".js") scripts[entry.path().stem()] = entry.path();
+    }
+    scripts["generated"] = generateSource(filesystem::temp_directory_path());
+    map<string, double> baseline;
+    if (!baselineFile.empty()) baseline = load(baselineFile);
+    vector<Result> results;
+    for (auto &script : scripts) {
+        if (!selected.empty() && find(selected.begin(), selected.end(), script.first) == selected.end()) continue;
+        results.push_back(benchmark(script.first, script.second, options));
+    }
+    bool slower = report(results, baseline);
+    if (!saveFile.empty()) save(saveFile, results, options);
+    return slower ? 1 : 0;
+}
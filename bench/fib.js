@@ -0,0 +1,8 @@
+function fibonacci(n) {
+    if (n < 2) {
+        return n;
+    }
+    return fibonacci(n - 1) + fibonacci(n - 2);
+}
+
+let result = fibonacci(27);
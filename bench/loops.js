@@ -0,0 +1,10 @@
+let sum = 0;
+for (let i = 0; i < 600; i = i + 1) {
+    for (let j = 0; j < 600; j = j + 1) {
+        if ((i + j) % 3 == 0) {
+            sum = sum + i * j;
+        } else {
+            sum = sum - j;
+        }
+    }
+}
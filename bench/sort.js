@@ -0,0 +1,27 @@
+function selectionSort(arr, length) {
+    for (let i = 0; i < length; i = i + 1) {
+        let minIndex = i;
+        for (let j = i; j < length; j = j + 1) {
+            if (arr[j] < arr[minIndex]) {
+                minIndex = j;
+            }
+        }
+        if (minIndex != i) {
+            let temp = arr[i];
+            arr[i] = arr[minIndex];
+            arr[minIndex] = temp;
+        }
+    }
+    return arr;
+}
+
+let length = 1500;
+let arr = [0];
+let seed = 12345;
+for (let i = 0; i < length; i = i + 1) {
+    seed = (seed * 1103 + 12345) % 65536;
+    arr[i] = seed;
+}
+let sorted = selectionSort(arr, length);
+let first = sorted[0];
+let last = sorted[length - 1];
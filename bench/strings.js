@@ -0,0 +1,19 @@
+let text = "";
+let line = "";
+for (let i = 0; i < 4000; i = i + 1) {
+    line = "item " + i;
+    if (i % 2 == 0) {
+        line = line + " even";
+    } else {
+        line = line + " odd";
+    }
+    text = text + line + ";";
+}
+let parts = [""];
+for (let i = 0; i < 2000; i = i + 1) {
+    parts[i] = "<" + i + ">";
+}
+let joined = "";
+for (let i = 0; i < 2000; i = i + 1) {
+    joined = joined + parts[i];
+}
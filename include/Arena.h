@@ -0,0 +1,73 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <string_view>
+#include <type_traits>
+
+// Bump allocator. Objects are carved out of large blocks and are never freed one by
+// one: release() runs the destructors of all non-trivial objects and frees the whole
+// arena in one go, keeping the first block for the next use.
+class Arena {
+public:
+    Arena();
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template<typename T>
+    T *make() {
+        T *object = new(allocate(sizeof(T), alignof(T))) T();
+        if (!std::is_trivially_destructible<T>::value) {
+            addFinalizer(object, [](void *p) { static_cast<T *>(p)->~T(); });
+        }
+        return object;
+    }
+    // count objects in one block, destroyed together.
+    template<typename T>
+    T *makeArray(size_t count) {
+        T *objects = static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; i < count; ++i) new(objects + i) T();
+        if (!std::is_trivially_destructible<T>::value) {
+            auto *range = new(allocate(sizeof(Range), alignof(Range))) Range{objects, count};
+            addFinalizer(range, [](void *p) {
+                auto *r = static_cast<Range *>(p);
+                for (size_t i = 0; i < r->count; ++i) static_cast<T *>(r->objects)[i].~T();
+            });
+        }
+        return objects;
+    }
+    void *allocate(size_t size, size_t align);
+    const char *copyString(std::string_view str); // NUL-terminated copy.
+    void release();
+    size_t getBytesUsed() const;
+
+private:
+    class Block {
+    public:
+        Block *next;
+        size_t size;
+        char *data() { return reinterpret_cast<char *>(this + 1); }
+    };
+    class Range {
+    public:
+        void *objects;
+        size_t count;
+    };
+    class Finalizer {
+    public:
+        void (*destroy)(void *);
+        void *object;
+        Finalizer *next;
+    };
+    Block *blocks; // Most recent block first.
+    char *position;
+    char *end;
+    size_t bytesUsed;
+    Finalizer *finalizers; // Most recent object first.
+    void addBlock(size_t minimum);
+    void addFinalizer(void *object, void (*destroy)(void *));
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef _ASSEMBLER_H
+#define _ASSEMBLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Emits the few x86-64 instructions the JIT needs. Memory operands are always a base
+// register plus a 32 bit displacement, and jumps always take 32 bit offsets. Only the
+// first eight general purpose and SSE registers can be encoded: no REX.R or REX.B bits
+// are emitted, so SSE register numbers must be below 8.
+class Assembler {
+public:
+    enum Register {
+        RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI
+    };
+    enum Condition {
+        OVERFLOW, NO_OVERFLOW, BELOW, ABOVE_EQUAL, EQUAL, NOT_EQUAL, BELOW_EQUAL, ABOVE,
+        SIGN, NO_SIGN, PARITY, NO_PARITY, LESS, GREATER_EQUAL, LESS_EQUAL, GREATER
+    };
+    typedef int Label;
+
+    Label newLabel();
+    void bind(Label label);
+    void jump(Label label);
+    void jump(Condition condition, Label label);
+
+    void push(Register reg);
+    void pop(Register reg);
+    void ret();
+    void call(Register target);
+    void move(Register destination, Register source);
+    void move(Register destination, uint64_t immediate);
+    void load(Register destination, Register base, int32_t offset);
+    void store(Register base, int32_t offset, Register source);
+    void store32(Register base, int32_t offset, uint32_t immediate);
+    void loadByte(Register destination, Register base, int32_t offset); // Zero extended.
+    void add(Register destination, Register source);
+    void add(Register destination, int32_t immediate);
+    void subtract(Register destination, Register source);
+    void subtract(Register destination, int32_t immediate);
+    void multiply(Register destination, Register source); // Signed, sets OF on overflow.
+    void negate(Register reg);
+    void signExtend(); // rdx:rax from rax, before a division.
+    void divide(Register divisor); // Signed rdx:rax by the divisor, quotient in rax, remainder in rdx.
+    void compare(Register left, Register right);
+    void test(Register left, Register right);
+    void compare32(Register base, int32_t offset, uint32_t immediate);
+    void shiftLeft(Register reg, uint8_t count);
+    void shiftRight(Register reg, uint8_t count);
+    void set(Condition condition, Register destination); // Low byte, zero extended to 64 bits.
+
+    // SSE2 scalar doubles, registers are numbered 0 to 7.
+    void loadDouble(int destination, Register base, int32_t offset);
+    void storeDouble(Register base, int32_t offset, int source);
+    void moveDouble(int destination, int source);
+    void moveToDouble(int destination, Register source); // Raw bits.
+    void convertToDouble(int destination, Register source);
+    void truncateToInteger(Register destination, int source);
+    void addDouble(int destination, int source);
+    void subtractDouble(int destination, int source);
+    void multiplyDouble(int destination, int source);
+    void divideDouble(int destination, int source);
+    void xorDouble(int destination, int source);
+    void compareDouble(int left, int right); // Unordered compare, sets ZF, PF and CF.
+
+    size_t size() const;
+    std::vector<uint8_t> finish(); // Resolves the jumps.
+
+private:
+    class Fixup {
+    public:
+        size_t position; // Of the 32 bit offset to patch.
+        Label label;
+    };
+    std::vector<uint8_t> code;
+    std::vector<long> labels; // Position of each label, -1 until bound.
+    std::vector<Fixup> fixups;
+    void emit(uint8_t byte);
+    void emit32(uint32_t value);
+    void emit64(uint64_t value);
+    void rexWide(); // 64 bit operand size.
+    void modrm(int mod, int reg, int rm);
+    void memory(int reg, Register base, int32_t offset);
+    void sse(uint8_t prefix, uint8_t opcode, int reg, int rm, bool wide = false);
+};
+
+#endif
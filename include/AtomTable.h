@@ -0,0 +1,36 @@
+#ifndef _ATOM_TABLE_H
+#define _ATOM_TABLE_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Interned identifiers shared by the lexer, the parser and the execution engines.
+// Every distinct name gets a small integer id, so symbol tables compare and hash
+// names as integers. Atoms live as long as the process.
+class AtomTable {
+public:
+    typedef unsigned Atom;
+    // Atoms interned up front, so builtins are recognised without a lookup.
+    enum {
+        NO_ATOM,
+        INPUT,
+        OUTPUT
+    };
+    static Atom intern(std::string_view name);
+    static const std::string& name(Atom atom);
+    static size_t size();
+
+private:
+    class Table {
+    public:
+        std::unordered_map<std::string_view, Atom> ids; // Keys point into names.
+        std::deque<std::string> names; // Indexed by atom, a deque keeps references stable.
+        Table();
+    };
+    static Table& table();
+};
+
+#endif
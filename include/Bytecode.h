@@ -0,0 +1,67 @@
+#ifndef _BYTECODE_H
+#define _BYTECODE_H
+
+#include "Value.h"
+#include <string>
+#include <vector>
+
+// Instruction set of the stack based VM. Operands are documented as (a, b).
+enum OpCode : unsigned char {
+    OP_CONSTANT, // Push constants[a].
+    OP_UNDEFINED, // Push undefined.
+    OP_POP, // Discard the top of the stack.
+    OP_LOAD_LOCAL, // Push local slot a of the current function frame.
+    OP_STORE_LOCAL, // Pop into local slot a.
+    OP_CLEAR_LOCALS, // Set the b local slots from slot a to undefined.
+    OP_LOAD_GLOBAL, // Push global slot a.
+    OP_STORE_GLOBAL, // Pop into global slot a.
+    OP_NEW_ARRAY, // Pop a elements and push a new array holding them.
+    OP_LOAD_ELEMENT, // Pop index and array, push the element.
+    OP_STORE_ELEMENT, // Pop value, index and array, store the element.
+    OP_ADD,
+    OP_SUBTRACT,
+    OP_MULTIPLY,
+    OP_DIVIDE,
+    OP_MODULO,
+    OP_LESS,
+    OP_LESS_EQUAL,
+    OP_GREATER,
+    OP_GREATER_EQUAL,
+    OP_EQUAL,
+    OP_NOT_EQUAL,
+    OP_NEGATE,
+    OP_JUMP, // Continue at instruction a.
+    OP_JUMP_IF_FALSE, // Pop the condition, continue at instruction a if it is falsy.
+    OP_CALL, // Call functions[a] with the b arguments on top of the stack.
+    OP_TAIL_CALL, // Like OP_CALL, but the callee replaces the current frame and returns to its caller.
+    OP_INPUT, // Push a line read from stdin.
+    OP_OUTPUT, // Pop a value and print it, push undefined.
+    OP_RETURN, // Pop the result, drop the frame and push the result for the caller.
+    OP_HALT
+};
+
+class Instruction {
+public:
+    OpCode op;
+    int a;
+    int b;
+};
+
+// A compiled function. The frame of a call holds numLocals slots, the first
+// arity of them receive the arguments.
+class Function {
+public:
+    std::string name;
+    int arity = 0;
+    int numLocals = 0;
+    std::vector<Instruction> code;
+};
+
+// Output of the compiler: functions[0] is the top-level code.
+class Program {
+public:
+    std::vector<Function> functions;
+    std::vector<Value> constants;
+};
+
+#endif
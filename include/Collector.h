@@ -0,0 +1,47 @@
+#ifndef _COLLECTOR_H
+#define _COLLECTOR_H
+
+#include "Value.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Cycle collector for arrays. Reference counting frees an array as soon as the last
+// value pointing to it goes away, except when arrays reference each other in a cycle.
+// collect() finds those by trial deletion: references coming from element buffers are
+// subtracted from every count, arrays left with a positive count are held from outside
+// (frames, the VM stack, temporaries) and everything reachable from them survives.
+// The rest is garbage. A buffer shared by copies holds one reference per element, so
+// each buffer is scanned once. A collection runs automatically before an allocation once the
+// number of live arrays reaches a threshold, which then doubles past the survivors.
+class Collector {
+public:
+    class Stats {
+    public:
+        size_t live = 0;
+        size_t peak = 0;
+        size_t allocated = 0;
+        size_t collections = 0;
+        size_t freed = 0; // Arrays freed by the collector, not by reference counting.
+    };
+    // New array holding the given elements. This is the only allocation point, and the
+    // only place a collection can start, so no half built array is ever scanned.
+    static Value newArray(std::vector<Value> elements);
+    static Value newArray(const Array *source); // Copy on write of the source.
+    static size_t collect();
+    static const Stats& getStats();
+    static void report();
+    static void setDebugMode(bool enable);
+
+private:
+    friend class Array;
+    static Array *arrays; // Live arrays, most recent first.
+    static size_t threshold;
+    static Stats stats;
+    static bool debug;
+    static void track(Array *array);
+    static void untrack(Array *array);
+    static void log(const std::string& message, const std::string& extra="");
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef _COMPILER_H
+#define _COMPILER_H
+
+#include "Bytecode.h"
+#include "Parser.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Compiles a resolved AST to bytecode for the VM. Block scopes of a function are
+// flattened into its frame, so every resolved (depth, slot) pair turns into either
+// a local slot of the current function or a global slot.
+class Compiler {
+public:
+    Program compile(Parser::ASTNode *root);
+    void setDebugMode(bool enable);
+
+private:
+    Program *program = nullptr;
+    Function *function = nullptr; // Function being compiled.
+    std::unordered_map<AtomTable::Atom, int> functionIndex;
+    std::vector<Parser::ASTNode*> declarations; // Declaration of each function, nullptr for the top level.
+    std::vector<int> scopeBases; // Offset of each open scope inside the current frame.
+    int frameOffset = 0;
+    // Jumps out of a loop being compiled, patched once their targets are known.
+    class Loop {
+    public:
+        std::vector<int> breaks;
+        std::vector<int> continues;
+    };
+    std::vector<Loop> loops;
+    bool debug = false;
+    void collectFunctions(Parser::ASTNode *node);
+    void compileFunction(Parser::ASTNode *node, int index);
+    void enterScope(int size);
+    void exitScope(int size);
+    void enterBlockScope(int size);
+    void exitBlockScope(int size);
+    void enterLoopBody(int size);
+    int emit(OpCode op, int a=0, int b=0);
+    void patch(int at, int target);
+    int here() const;
+    int addConstant(const Value& value);
+    void emitLoad(Parser::ASTNode *node);
+    void emitStore(Parser::ASTNode *node);
+    void compileStatementList(Parser::ASTNode *node);
+    void compileStatement(Parser::ASTNode *node);
+    void compileExpression(Parser::ASTNode *node);
+    void compileCall(Parser::ASTNode *node, bool isTail = false);
+    void compileLogical(Parser::ASTNode *node);
+    void patchJumps(const std::vector<int>& jumps, int target);
+    static void error(const std::string& message, const std::string& extra="");
+    void log(const std::string& message, const std::string& extra="");
+};
+
+#endif
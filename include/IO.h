@@ -0,0 +1,25 @@
+#ifndef _IO_H
+#define _IO_H
+
+#include <string>
+#include <string_view>
+
+// Standard input and output of scripts. Output goes straight into stdio's buffer, which
+// is large and only flushed when it fills up, before input is read and at exit, or at
+// every newline on a terminal. cout stays synchronized with stdio, so whatever else is
+// printed through it keeps its place. Input is read in large blocks and split into lines here.
+class IO {
+public:
+    static void init(bool unbuffered); // Call before anything is printed.
+    static void write(std::string_view text);
+    static void flush();
+    static bool readLine(std::string& line); // False at the end of the input.
+
+private:
+    static char input[];
+    static size_t inputStart; // Unread input is input[inputStart, inputEnd).
+    static size_t inputEnd;
+    static bool unbuffered;
+};
+
+#endif
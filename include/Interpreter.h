@@ -1,62 +1,125 @@
 #ifndef _INTERPRETER_H
 #define _INTERPRETER_H
 
+#include "MemoTable.h"
 #include "Parser.h"
-#include <map>
+#include "Profiler.h"
+#include "Resolver.h"
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 using std::string;
 
+class Jit;
+
 class Interpreter {
+    friend class VM;
 public:
-    class Variable {
+    enum Engine {
+        TREE_WALKER, // Reference implementation: walks the AST.
+        BYTECODE_VM // Compiles the AST to bytecode and runs it on the VM.
+    };
+    class Frame {
     public:
-        Lexer::TokenType type;
-        std::string value;
+        std::vector<Value> slots;
+        Frame *parent; // Enclosing frame, function frames are linked to the globals.
+        Frame(int size, Frame *parent) : slots(size), parent(parent) {}
     };
     Interpreter();
+    ~Interpreter();
     void interpretFile(std::string& filename);
+    void loadFile(std::string& filename);
+    void run(); // Run the loaded script.
     void shell();
     void setDebugMode(bool enable);
+    void setEngine(Engine engine);
+    void setGcStats(bool enable);
+    void setCacheDirectory(const std::string& directory); // Enables the script cache.
+    void setOptimizationLevel(int level); // 0 runs the tree as parsed.
+    void setMemoize(bool enable); // Memoize calls to pure functions in the tree walker.
+    void setProfileFile(const std::string& filename); // Profile the tree walker into folded stacks.
+    void setJit(int threshold); // Compile loops of the tree walker after threshold iterations, 0 disables.
+    void setJitStats(bool enable);
+    static Value applyOperator(Parser::Operator op, const Value& left, const Value& right);
 
 private:
     Parser parser;
-    std::map<std::string, Parser::ASTNode*> functionTable;
-    std::vector<std::map<std::string, Variable>*> variableTable;
-    std::map<std::string, std::vector<std::string>*> arrayTable;
-    std::vector<string>* getArray(const std::string& name, bool isIdentifier=false);
-    string copyArray(const std::string& identifier);
-    std::string returnValue;
-    int scopeLevel;
-    void enterScope();
-    void exitScope();
-    bool declareVariable(const std::string& name, const Variable& variable);
-    bool setVariableValue(const std::string& name, const Variable& variable);
-    string getVariableValue(const std::string& name);
+    Resolver resolver;
+    std::unordered_map<AtomTable::Atom, Parser::ASTNode*> functionTable;
+    unsigned functionTableVersion = 1; // Bumped on every change, invalidates the call site caches.
+    Frame *globals;
+    Frame *frame; // Current frame.
+    std::vector<Frame*> framePool;
+    Frame *newFrame(int size, Frame *parent);
+    void freeFrame(Frame *f);
+    Value getArray(Parser::ASTNode *node); // A reference keeping the array alive.
+    static Value copyArray(const Value& array);
+    Value returnValue;
+    // How the last statement completed. Anything but NORMAL skips the rest of the enclosing
+    // statement lists until a loop or a call consumes it.
+    enum Completion {
+        NORMAL,
+        RETURN,
+        BREAK,
+        CONTINUE
+    };
+    Completion completion = NORMAL;
+    bool endIteration();
+    Parser::ASTNode *tailCallee = nullptr; // Pending tail call, run by the enclosing call.
+    Frame *tailFrame = nullptr;
+    Parser::ASTNode *getCallee(Parser::ASTNode *call);
+    Frame *newCallFrame(Parser::ASTNode *call, Parser::ASTNode *function);
+    Frame *enterScope(int size, Frame *parent);
+    void exitScope(Frame *previous);
+    Value& variable(Parser::ASTNode *node);
+    void declareVariable(Parser::ASTNode *node, const Value& value);
+    void setVariableValue(Parser::ASTNode *node, const Value& value);
+    Value getVariableValue(Parser::ASTNode *node);
     void printVariableTable();
-    Parser::ASTNode* getFunction(const std::string& name);
+    Parser::ASTNode* getFunction(Parser::ASTNode *call);
     Parser::ASTNode *root;
     bool debug = false;
+    Engine engine = TREE_WALKER;
+    bool gcStats = false;
+    std::string cacheDirectory;
+    int optimizationLevel = 1;
+    bool memoize = false;
+    std::vector<MemoTable> memoTables;
+    std::vector<Parser::ASTNode*> memoized; // Declarations owning the memo tables.
+    void reportMemoTables();
+    std::string profileFile;
+    std::unique_ptr<Profiler> profiler; // Only while a profiled script runs.
+    int jitThreshold = 0;
+    bool jitStats = false;
+    Jit *jit = nullptr; // Only while a script runs with the JIT.
+    bool runCompiledLoop(Parser::ASTNode *node, Parser::ASTNode *update, bool& finished);
     static void error(const std::string& message, const std::string& extra="");
     void log(const std::string& message, const std::string& extra="");
     bool shellExecute(const string& input);
     static string input();
-    static void output(const std::string& str);
-    string visitNode(Parser::ASTNode *node);
-    string visitDeclareNode(Parser::ASTNode *node);
-    string visitAssignNode(Parser::ASTNode *node);
-    string visitExpressionNode(Parser::ASTNode *node);
-    string visitIfNode(Parser::ASTNode *node);
-    string visitNegativeNode(Parser::ASTNode *node);
-    string visitBinaryOperatorNode(Parser::ASTNode *node);
-    string visitWhileNode(Parser::ASTNode *node);
-    string visitForNode(Parser::ASTNode *node);
-    string visitFunctionDeclareNode(Parser::ASTNode *node);
-    string visitFunctionCallNode(Parser::ASTNode *node);
-    string visitReturnNode(Parser::ASTNode *node);
-    string visitArrayDeclareNode(Parser::ASTNode *node);
-    string visitArrayAccessNode(Parser::ASTNode *node);
+    static void output(const Value& value);
+    Value visitNode(Parser::ASTNode *node);
+    Value visitStatementList(Parser::ASTNode *node);
+    Value visitDeclareNode(Parser::ASTNode *node);
+    Value visitAssignNode(Parser::ASTNode *node);
+    Value visitExpressionNode(Parser::ASTNode *node);
+    Value visitIfNode(Parser::ASTNode *node);
+    Value visitNegativeNode(Parser::ASTNode *node);
+    Value visitBinaryOperatorNode(Parser::ASTNode *node);
+    void specializeOperator(Parser::ASTNode *node, const Value& left, const Value& right);
+    static Value integerOperator(Parser::Operator op, int64_t left, int64_t right);
+    static Value numberOperator(Parser::Operator op, double left, double right);
+    static Value stringOperator(Parser::Operator op, const std::string& left, const std::string& right);
+    Value visitWhileNode(Parser::ASTNode *node);
+    Value visitForNode(Parser::ASTNode *node);
+    Value visitFunctionDeclareNode(Parser::ASTNode *node);
+    Value visitFunctionCallNode(Parser::ASTNode *node);
+    Value visitReturnNode(Parser::ASTNode *node);
+    Value visitArrayDeclareNode(Parser::ASTNode *node);
+    Value visitArrayAccessNode(Parser::ASTNode *node);
+    void specializeAccess(Parser::ASTNode *node, const Value& index);
 };
 
 
@@ -0,0 +1,159 @@
+#ifndef _JIT_H
+#define _JIT_H
+
+#include "Assembler.h"
+#include "Interpreter.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Tracing JIT for the loops of the tree walker. A while or for loop that runs more than
+// threshold iterations is recorded for a few more: the walker reports which way each if
+// went and what type each array read produced. The paths seen are then compiled to
+// x86-64 with the types of the variables at that point, one copy of the rest of the
+// iteration per branch direction, so every value has a known type. Branches that went only
+// one way, out of bounds indexes and unexpected element types leave the native code
+// through a side exit, and the walker finishes the iteration from the statement the exit
+// belongs to: statements only write after all their guards passed. A loop entered with
+// other types gets another trace. An exit guarding what the recording saw that is taken
+// too often gets the loop recorded and compiled again, including the path that led to it.
+//
+// Only loops without nested loops, calls, jumps or declarations in their body and working
+// on numbers, booleans and arrays of them are compiled. Integers and booleans are kept in
+// general purpose registers, reals in SSE registers, and integer results the walker
+// would turn into reals, on overflow for instance, exit.
+class Jit {
+public:
+    class Exit {
+    public:
+        enum Kind {
+            LOOP_END, // The condition is false.
+            RESUME_CONDITION, // Run the iteration from the condition.
+            RESUME_BODY, // Run the statement lists in resume, then the update.
+            RESUME_UPDATE // Run the update.
+        };
+        Kind kind;
+        std::vector<Parser::ASTNode*> resume;
+        unsigned taken = 0;
+        bool isGuess = false; // Guards what the recording saw, a hot one gets the loop recorded again.
+    };
+    explicit Jit(int threshold);
+    ~Jit();
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+    // Called at the head of every iteration of a loop. Runs the loop's trace if it has one
+    // and the variables have the types it was compiled for, and returns the exit it took.
+    const Exit *iteration(Parser::ASTNode *loop, Interpreter::Frame *frame);
+    // Called when a loop ends. A recording loop gives up the recorder and resumes recording
+    // when it runs again, if no other loop took it in between.
+    void loopFinished(Parser::ASTNode *loop);
+    bool isRecording() const { return recording >= 0; }
+    void recordBranch(Parser::ASTNode *node, bool taken);
+    void recordElement(Parser::ASTNode *node, const Value& element);
+    void recordQuotient(Parser::ASTNode *node, const Value& quotient);
+    void report() const;
+    void setDebugMode(bool enable);
+
+private:
+    // What the native code gets for each variable: the value itself and, for arrays, the
+    // elements, whose buffer stays put as long as no element is added.
+    class Slot {
+    public:
+        Value *value;
+        Value *elements;
+        int64_t size;
+    };
+    class Variable {
+    public:
+        int depth;
+        int slot;
+        Value::Type type; // At the head of the loop.
+        bool isArray;
+        bool isWritten; // An array whose elements are assigned.
+    };
+    class Trace {
+    public:
+        uint32_t (*code)(Slot *slots) = nullptr;
+        size_t codeSize = 0;
+        std::vector<Variable> variables;
+        std::vector<Exit> exits;
+        std::vector<Slot> slots;
+    };
+    enum State {
+        COUNTING,
+        RECORDING,
+        COMPILED,
+        BLACKLISTED
+    };
+    class Loop {
+    public:
+        Parser::ASTNode *node;
+        State state = COUNTING;
+        int iterations = 0;
+        int compilations = 0;
+        bool retrace = false;
+        std::unordered_map<Parser::ASTNode*, uint8_t> branches; // Bit 0: seen false, bit 1: seen true.
+        std::unordered_map<Parser::ASTNode*, uint8_t> elements; // Bit per Value::Type read.
+        std::unordered_map<Parser::ASTNode*, uint8_t> quotients; // Bit per Value::Type divided.
+        std::vector<Trace*> traces; // One per set of entry types.
+    };
+    // Compilation state of one trace.
+    class Compiler {
+    public:
+        Loop *loop;
+        Interpreter::Frame *frame;
+        Trace *trace;
+        Assembler assembler;
+        std::vector<Assembler::Label> exitLabels;
+        Assembler::Label head;
+        int stackDepth = 0; // Temporaries pushed on the native stack.
+        std::string abort; // Why the loop can't be compiled, empty if it can.
+    };
+    typedef std::vector<Value::Type> Types; // Static type of each variable, missing ones have their entry type.
+    static const int32_t TYPE_OFFSET; // Of the fields of a Value.
+    static const int32_t PAYLOAD_OFFSET;
+    int threshold;
+    std::vector<Loop> loops;
+    int recording = -1; // Index of the loop being recorded.
+    bool debug = false;
+    size_t compiled = 0;
+    size_t aborted = 0;
+    size_t recompiled = 0; // Traces after the first of a loop.
+    size_t entries = 0;
+    size_t guardMisses = 0; // Entries refused: no trace for the types of the variables.
+    size_t exits[4] = {0, 0, 0, 0}; // By kind.
+    Loop& getLoop(Parser::ASTNode *node);
+    Trace *compile(Loop& loop, Interpreter::Frame *frame);
+    const Exit *run(Loop& loop, Interpreter::Frame *frame);
+    bool enter(Trace& trace, Interpreter::Frame *frame);
+    const Exit *execute(Loop& loop, Trace& trace);
+    void release(Loop& loop);
+    static Parser::ASTNode *condition(Parser::ASTNode *loop);
+    static Parser::ASTNode *body(Parser::ASTNode *loop);
+    static Parser::ASTNode *update(Parser::ASTNode *loop);
+    static Value& resolve(Interpreter::Frame *frame, int depth, int slot);
+    int variable(Compiler& c, Parser::ASTNode *node, bool isArray);
+    static Value::Type typeOf(const Compiler& c, const Types& types, int variable);
+    static int32_t slotOffset(int variable);
+    int newExit(Compiler& c, Exit::Kind kind, const std::vector<Parser::ASTNode*>& resume);
+    int guessExit(Compiler& c, int exit);
+    bool compileStatements(Compiler& c, Parser::ASTNode *statement, std::vector<Parser::ASTNode*> rest, Types types);
+    bool compileAssign(Compiler& c, Parser::ASTNode *node, Types& types, int exit);
+    bool compileExpression(Compiler& c, Parser::ASTNode *node, const Types& types, int exit, Value::Type& type);
+    bool compileBinary(Compiler& c, Parser::ASTNode *node, const Types& types, int exit, Value::Type& type);
+    bool compileElement(Compiler& c, Parser::ASTNode *node, const Types& types, int exit, Value::Type& type);
+    bool compileAddress(Compiler& c, int variable, Parser::ASTNode *index, const Types& types, int exit);
+    bool compileIntegers(Compiler& c, Parser::ASTNode *node, int exit, Value::Type& type);
+    bool compileQuotient(Compiler& c, Parser::ASTNode *node, int exit, Value::Type& type);
+    void compileTruth(Compiler& c, Value::Type type);
+    void toDouble(Compiler& c, Value::Type type, int xmm);
+    void loadValue(Compiler& c, Assembler::Register address, Value::Type type);
+    void storeValue(Compiler& c, Assembler::Register address, Assembler::Register source, Value::Type type);
+    void pushValue(Compiler& c, Value::Type type);
+    void popDouble(Compiler& c, int xmm);
+    static bool isPure(Parser::ASTNode *node);
+    void log(const std::string& message, const std::string& extra="");
+};
+
+#endif
@@ -1,9 +1,10 @@
 #ifndef _LEXER_H
 #define _LEXER_H
 
-#include <set>
+#include "AtomTable.h"
+#include "MappedFile.h"
 #include <string>
-#include <fstream>
+#include <string_view>
 
 class Lexer {
 public:
@@ -20,28 +21,80 @@ public:
         END_OF_FILE, // EOF
         END_OF_LINE // Used in interactive mode
     };
-struct Token {
+    // Fine-grained kind of keyword and symbol tokens.
+    enum TokenKind {
+        NO_KIND, // Identifiers, literals and special tokens.
+        // Keywords.
+        KW_FUNCTION,
+        KW_VAR,
+        KW_LET,
+        KW_CONST,
+        KW_TRUE,
+        KW_FALSE,
+        KW_THIS,
+        KW_IF,
+        KW_ELSE,
+        KW_WHILE,
+        KW_RETURN,
+        KW_UNDEFINED,
+        KW_NULL,
+        KW_FOR,
+        KW_BREAK,
+        KW_CONTINUE,
+        KW_CLASS,
+        // Symbols.
+        LEFT_BRACE, // {
+        RIGHT_BRACE, // }
+        LEFT_PAREN, // (
+        RIGHT_PAREN, // )
+        LEFT_BRACKET, // [
+        RIGHT_BRACKET, // ]
+        DOT, // .
+        COMMA, // ,
+        SEMICOLON, // ;
+        PLUS, // +
+        MINUS, // -
+        STAR, // *
+        SLASH, // /
+        PERCENT, // %
+        AMPERSAND, // &
+        PIPE, // |
+        BANG, // !
+        LESS, // <
+        GREATER, // >
+        ASSIGN, // =
+        GREATER_EQUAL, // >=
+        LESS_EQUAL, // <=
+        EQUAL, // ==
+        NOT_EQUAL, // !=
+        AND, // &&
+        OR // ||
+    };
+    // Tokens are views into the source: copy the value before the source goes away.
+    struct Token {
         TokenType type; // Token's type.
-        std::string value; // Token's value.
+        TokenKind kind; // Token's kind, for keywords and symbols.
+        std::string_view value; // Token's value.
+        AtomTable::Atom atom; // Interned name of identifier tokens.
         unsigned rowNumber; // The row where the token is located.
     };
 
 private:
-    std::string rowBuffer; // Store current row.
-    unsigned rowBufferPos; // Pointer position for row buffer.
+    // The whole source is in memory: a mapped file, or the lines typed in the REPL.
+    MappedFile file;
+    std::string line; // Current REPL line.
+    const char *begin;
+    const char *cursor; // Next character.
+    const char *end;
+    bool interactive; // The end of the source is the end of a REPL line, not of a file.
     unsigned rowNumber; // Current row.
-    std::ifstream file; // File input stream object.
-    std::string input;
     char nextChar(); // Get next char.
-    void rollBack(); // Roll back line buffer (rowBufferPos--).
-    void initKeywordsAndSymbols();
-    bool isKeyword(std::string const& str);
-    bool isSymbol(std::string const& str);
+    void rollBack(); // Step back one char.
+    static TokenKind keywordKind(std::string_view word);
+    static TokenKind symbolKind(char c, char next, bool& twoChars);
     bool debug = false;
 
 public:
-    std::set<std::string> keywords;
-    std::set<std::string> symbols;
     Lexer(); // Constructor function.
     void openFile(std::string const& filename); // Open source file.
     void closeFile(); // Close source file.
@@ -0,0 +1,26 @@
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file. Regular files are memory mapped, anything that
+// cannot be mapped (pipes, empty files) is read into memory instead.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    bool open(const std::string& filename);
+    void close();
+    const char *data() const;
+    size_t size() const;
+
+private:
+    void *mapping;
+    size_t length;
+    std::string contents; // Used when the file is not mapped.
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef _MEMO_TABLE_H
+#define _MEMO_TABLE_H
+
+#include "Value.h"
+#include <cstddef>
+#include <vector>
+
+// Results of a pure function keyed by its argument values. Arguments match only if they
+// have the same type and the same contents, so 1 and 1.0 are different keys. The table
+// is direct mapped with a fixed number of entries: a colliding insert replaces the older
+// result, which bounds the memory held by functions called with many distinct arguments.
+class MemoTable {
+public:
+    bool find(const Value *arguments, size_t count, Value& result);
+    void insert(const Value *arguments, size_t count, const Value& result);
+    size_t getHits() const;
+    size_t getMisses() const;
+
+private:
+    class Entry {
+    public:
+        std::vector<Value> arguments;
+        Value result;
+        bool used = false;
+    };
+    std::vector<Entry> entries; // Allocated on the first insert.
+    size_t hits = 0;
+    size_t misses = 0;
+    static size_t hash(const Value *arguments, size_t count);
+    static bool same(const Value& left, const Value& right);
+};
+
+#endif
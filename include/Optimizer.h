@@ -0,0 +1,58 @@
+#ifndef _OPTIMIZER_H
+#define _OPTIMIZER_H
+
+#include "Parser.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Rewrites a parsed tree in place before it is resolved. Constant arithmetic, comparison
+// and boolean subexpressions are folded into literals, const declarations with a constant
+// initializer are propagated into their uses, and statements that can never run are
+// removed: branches of constant conditions and statements after a return, break or continue.
+// Nothing that declares a name is ever removed, so resolution is unchanged.
+class Optimizer {
+public:
+    // A REPL line is not a whole program: later lines may reassign its constants and
+    // the value of its first statement is printed, so only folding applies at its top level.
+    Parser::ASTNode *optimize(Parser::ASTNode *root, bool isProgram);
+    void setDebugMode(bool enable);
+
+private:
+    class Constant {
+    public:
+        Parser::ASTNode *literal;
+        bool beforeCalls; // Declared before any call could run a function that reads it.
+    };
+    class Scope {
+    public:
+        std::unordered_map<AtomTable::Atom, Constant> constants;
+        bool isFunction = false;
+    };
+    std::vector<Scope> scopes; // scopes[0] is the global scope.
+    std::unordered_map<AtomTable::Atom, int> bindings; // Declarations and parameters of each name.
+    std::unordered_set<AtomTable::Atom> assigned; // Names that are assigned somewhere.
+    bool propagate = false;
+    int conditional = 0; // Nesting of if branches in the current scope.
+    int functionDepth = 0;
+    int topLevelCalls = 0; // Calls seen so far outside of function bodies.
+    int folded = 0;
+    int propagated = 0;
+    int removed = 0;
+    bool debug = false;
+    void countBindings(Parser::ASTNode *node);
+    Parser::ASTNode *optimizeList(Parser::ASTNode *node);
+    void optimizeStatement(Parser::ASTNode *node);
+    void fold(Parser::ASTNode *node);
+    void declareConstant(Parser::ASTNode *node);
+    Parser::ASTNode *lookupConstant(Parser::ASTNode *node);
+    void makeConstant(Parser::ASTNode *node, const Value& value);
+    static bool isConstant(Parser::ASTNode *node);
+    static bool declares(Parser::ASTNode *node);
+    static bool declaresFunction(Parser::ASTNode *node);
+    static int countStatements(Parser::ASTNode *node);
+    void log(const std::string& message, const std::string& extra="");
+};
+
+#endif
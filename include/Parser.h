@@ -1,12 +1,15 @@
 #ifndef _PARSER_H
 #define _PARSER_H
 
+#include "Arena.h"
 #include "Lexer.h"
+#include "Value.h"
 #include <string>
-#include <deque>
+#include <memory>
 #include <vector>
 
 class Parser {
+    friend class ScriptCache;
 public:
     enum NodeType {
         NONE,
@@ -32,27 +35,94 @@ public:
         NEGATIVE_NODE,
         ARGUMENT_NODE,
         ARRAY_ACCESS_NODE,
-        ARRAY_DECLARE_NODE
+        ARRAY_DECLARE_NODE,
+        BREAK_NODE,
+        CONTINUE_NODE
     };
+    // Operator code of BINARY_OPERATOR_NODE, resolved at parse time.
+    enum Operator {
+        OP_NONE,
+        OP_ADD,
+        OP_SUB,
+        OP_MUL,
+        OP_DIV,
+        OP_MOD,
+        OP_LT,
+        OP_LE,
+        OP_GT,
+        OP_GE,
+        OP_EQ,
+        OP_NE,
+        OP_AND,
+        OP_OR
+    };
+    // Variant a BINARY_OPERATOR_NODE or ARRAY_ACCESS_NODE of the tree walker rewrites itself
+    // to after the types of the operands it sees.
+    enum Specialization {
+        UNSPECIALIZED, // Specializes on its next evaluation.
+        GENERIC, // Any types, through Value's operators.
+        INT_INT, // Two integers.
+        REAL_REAL, // Two reals.
+        NUMBER_NUMBER, // Two numbers, integers or reals.
+        STRING_STRING, // Concatenation and comparison of two strings.
+        INT_INDEX, // Element at an integer index.
+        REAL_INDEX // Element at a real index.
+    };
+    // Nodes live in the parser's arena and are released together with their tree.
     class ASTNode {
     public:
-        Lexer::Token token;
+        const char *text; // Text of the node's token: a name, an operator or a literal.
+        AtomTable::Atom atom; // Interned name of variable and function nodes.
+        unsigned rowNumber; // The row where the token is located.
+        Value value; // Constant value of literal nodes.
         ASTNode *child[4];
         ASTNode *next;
         NodeType type;
+        Operator op;
+        int depth; // Resolved frame distance of a variable.
+        int slot; // Resolved slot of a variable in its frame.
+        int scopeSize; // Frame size of a function or loop header scope.
+        int bodyScopeSize; // Frame size of a loop body scope.
+        bool isConst; // Declared with const.
+        ASTNode *callee; // Cached target of a call, valid while calleeVersion matches the function table.
+        unsigned calleeVersion;
+        int memo; // Memo table of a function whose calls are memoized, -1 if none.
+        bool isTailCall; // A return of a call that nothing runs after, so the call can reuse the frame.
+        int jitLoop; // State of a loop in the JIT, -1 until the JIT first sees it.
+        Specialization specialization;
+        int despecializations; // Guards that failed, past a few the node stays GENERIC.
         ASTNode() {
+            text = "";
+            atom = AtomTable::NO_ATOM;
+            rowNumber = 0;
             type = NONE;
+            op = OP_NONE;
+            depth = slot = -1;
+            scopeSize = bodyScopeSize = 0;
+            isConst = false;
+            callee = nullptr;
+            calleeVersion = 0;
+            memo = -1;
+            isTailCall = false;
+            jitLoop = -1;
+            specialization = UNSPECIALIZED;
+            despecializations = 0;
             child[0] = child[1] = child[2] = child[3] = nullptr;
             next = nullptr;
         }
     };
 private:
     ASTNode *root;
+    std::unique_ptr<Arena> arena; // Holds the last parsed tree.
+    std::vector<std::unique_ptr<Arena>> keptArenas;
     Lexer lexer;
-    Lexer::Token getToken();
+    ASTNode *newNode();
+    void setToken(ASTNode *node, const Lexer::Token& token);
+    std::vector<Lexer::Token> tokens; // Tokens of the whole source.
+    size_t position; // Index of the next token, backtracking steps it back.
+    void tokenize();
+    const Lexer::Token& getToken();
     void restoreToken();
-    std::deque<Lexer::Token> leftTokenBuffer;
-    std::deque<Lexer::Token> rightTokenBuffer;
     void error(const std::string& message, const Lexer::Token& token);
     void log(const std::string& message, const Lexer::Token& token);
     void parseProgram();
@@ -65,6 +135,7 @@ private:
     ASTNode *parseWhileStatement();
     ASTNode *parseForStatement();
     ASTNode *parseReturnStatement();
+    ASTNode *parseJumpStatement();
     ASTNode *parseFunction();
     ASTNode *parseCallExpression();
     ASTNode *parseArgumentList();
@@ -76,13 +147,17 @@ private:
     ASTNode *parsePositiveFactor();
     ASTNode *parseArrayDeclareExpression();
     ASTNode *parseArrayAccessExpression();
+    static bool startsStatement(const Lexer::Token& token);
+    static Operator relationalOperator(Lexer::TokenKind kind);
     static void printASTHelper(ASTNode *node, int depth);
     bool debug = false;
+    int loopDepth = 0; // Loops around the statement being parsed, inside the current function.
     
 public:
     explicit Parser();
     void parseFile(std::string &filename);
     ASTNode *parseInput(std::string input);
+    void keepAST();
     ASTNode *getAST();
     void printAST();
     void setDebugMode(bool enable);
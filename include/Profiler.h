@@ -0,0 +1,55 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <csignal>
+#include <cstddef>
+#include <map>
+#include <string>
+
+// Sampling profiler for scripts. The interpreter keeps a stack of the functions being
+// run, each with the row it is at, and a SIGPROF timer copies that stack into a sample
+// buffer every millisecond of CPU time. The handler never allocates: the buffer is
+// drained into folded stacks ("caller:row;callee:row count" lines, the input of flame
+// graph tools) by the interpreter itself, whenever it gets half full and at the end.
+class Profiler {
+public:
+    Profiler();
+    ~Profiler();
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+    void start();
+    void stop();
+    void enter(const char *name, unsigned row);
+    void leave();
+    void replace(const char *name, unsigned row); // A tail call takes over the top frame.
+    void setRow(unsigned row) {
+        if (depth > 0 && depth <= MAX_DEPTH) stack[depth - 1].row = row;
+        if (used > (sig_atomic_t) (BUFFER_SIZE / 2)) drain();
+    }
+    bool write(const std::string& filename);
+    size_t getSampleCount() const;
+    size_t getDroppedCount() const;
+
+private:
+    class Entry {
+    public:
+        const char *name; // nullptr starts a sample, then row holds the number of frames.
+        unsigned row;
+    };
+    static const int MAX_DEPTH = 1 << 14; // Deeper frames are counted but not sampled.
+    static const size_t BUFFER_SIZE = 1 << 16;
+    Entry *stack;
+    volatile sig_atomic_t depth = 0;
+    Entry *buffer;
+    volatile sig_atomic_t used = 0;
+    volatile sig_atomic_t dropped = 0;
+    size_t samples = 0;
+    std::map<std::string, size_t> folded;
+    bool running = false;
+    static Profiler *active; // The profiler the signal handler samples.
+    static void handler(int signal);
+    void sample();
+    void drain();
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _PURITY_H
+#define _PURITY_H
+
+#include "Parser.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Finds the functions of a resolved program whose result only depends on their arguments:
+// they do no input or output, read and assign nothing outside their own frame, write no
+// array elements, declare no functions and only call functions that are pure as well.
+// Calls to such functions can be memoized.
+class Purity {
+public:
+    std::vector<Parser::ASTNode*> analyze(Parser::ASTNode *root); // The pure function declarations.
+    void setDebugMode(bool enable);
+
+private:
+    class Function {
+    public:
+        Parser::ASTNode *declaration;
+        std::unordered_set<AtomTable::Atom> callees;
+        bool isPure = true;
+    };
+    std::vector<Function> functions;
+    std::unordered_map<AtomTable::Atom, int> functionIndex; // -1 for names declared more than once.
+    bool debug = false;
+    void collectFunctions(Parser::ASTNode *node);
+    void analyzeList(Function& function, Parser::ASTNode *node, int open);
+    void analyzeNode(Function& function, Parser::ASTNode *node, int open);
+    void log(const std::string& message, const std::string& extra="");
+};
+
+#endif
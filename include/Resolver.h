@@ -0,0 +1,47 @@
+#ifndef _RESOLVER_H
+#define _RESOLVER_H
+
+#include "Parser.h"
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Static resolution pass run after parsing. Every variable reference, assignment
+// and declaration gets annotated with a (depth, slot) pair: depth is the number of
+// frames to walk up from the current one, slot is the index in that frame.
+// Scope owning nodes get the size of the frames they create. Loop scopes that declare
+// nothing are elided: their size is 0 and no frame is created for them at runtime.
+// Returns of a user function call inside a function are marked as tail calls.
+class Resolver {
+public:
+    Resolver();
+    void resolve(Parser::ASTNode *node);
+    int getGlobalCount() const; // Size of the global frame.
+    const std::map<std::string, int>& getGlobals() const; // Declared globals and their slots.
+    void setDebugMode(bool enable);
+
+private:
+    class Scope {
+    public:
+        std::unordered_map<AtomTable::Atom, int> names;
+        int size = 0;
+        bool isFunction = false;
+        bool isElided = false;
+    };
+    std::vector<Scope> scopes; // scopes[0] is the global scope, kept across calls.
+    std::map<std::string, int> declaredGlobals;
+    bool debug = false;
+    void enterScope(bool isFunction, bool isElided);
+    static bool declaresVariables(Parser::ASTNode *node);
+    bool isInFunction() const;
+    static bool isUserCall(Parser::ASTNode *node);
+    int exitScope();
+    void declare(Parser::ASTNode *node);
+    void lookup(Parser::ASTNode *node);
+    void resolveNode(Parser::ASTNode *node);
+    void resolveList(Parser::ASTNode *node);
+    void log(const std::string& message, const std::string& extra="");
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef _SCANNER_H
+#define _SCANNER_H
+
+#include <array>
+#include <cstddef>
+
+// Character classification and run skipping for the lexer. Classes come from a table
+// built at compile time. Whitespace, identifier and digit runs are skipped 32 or 16
+// bytes at a time with AVX2 or SSE2 when the CPU has them, byte by byte otherwise.
+class Scanner {
+public:
+    enum CharClass : unsigned char {
+        SPACE = 1,
+        ALPHA = 2, // Letters and '_', the characters starting an identifier.
+        DIGIT = 4,
+        SYMBOL = 8,
+        IDENTIFIER = ALPHA | DIGIT
+    };
+    enum Mode {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+    static bool is(char c, unsigned char classes) {
+        return (table[(unsigned char) c] & classes) != 0;
+    }
+    // Each returns the first character at or after p not in the run, at most end.
+    static const char *skipSpace(const char *p, const char *end, unsigned& newlines);
+    static const char *skipIdentifier(const char *p, const char *end);
+    static const char *skipDigits(const char *p, const char *end);
+    static Mode getMode();
+    static void setMode(Mode mode); // Falls back to the best mode the CPU supports.
+    static const char *modeName(Mode mode);
+
+private:
+    static constexpr std::array<unsigned char, 256> makeTable() {
+        std::array<unsigned char, 256> classes{};
+        for (const char *c = " \t\n\v\f\r"; *c; ++c) classes[(unsigned char) *c] = SPACE;
+        for (int c = 'a'; c <= 'z'; ++c) classes[c] = ALPHA;
+        for (int c = 'A'; c <= 'Z'; ++c) classes[c] = ALPHA;
+        classes['_'] = ALPHA;
+        for (int c = '0'; c <= '9'; ++c) classes[c] = DIGIT;
+        for (const char *c = "{}()[].,;+-*/%&|!<>="; *c; ++c) classes[(unsigned char) *c] = SYMBOL;
+        return classes;
+    }
+    static const std::array<unsigned char, 256> table;
+    static Mode mode;
+};
+
+inline constexpr std::array<unsigned char, 256> Scanner::table = Scanner::makeTable();
+
+#endif
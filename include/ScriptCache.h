@@ -0,0 +1,29 @@
+#ifndef _SCRIPT_CACHE_H
+#define _SCRIPT_CACHE_H
+
+#include "Parser.h"
+#include <cstdint>
+#include <string>
+
+// Persistent cache of parsed scripts. The AST of a script is serialized into the
+// cache directory under the hash of the script's content. On a hit the entry is
+// memory mapped and the tree rebuilt from it without lexing or parsing. Entries
+// that do not match the source or the current format are rebuilt. The format uses
+// the byte order and layout of the machine that wrote it.
+class ScriptCache {
+public:
+    explicit ScriptCache(const std::string& directory);
+    void parseFile(const std::string& filename, Parser& parser); // Load from the cache or parse and store.
+    void setDebugMode(bool enable);
+
+private:
+    std::string directory;
+    bool debug = false;
+    static uint64_t hash(const char *data, size_t size);
+    std::string entryPath(uint64_t sourceHash) const;
+    bool load(const std::string& path, uint64_t sourceHash, uint64_t sourceSize, Parser& parser);
+    void store(const std::string& path, uint64_t sourceHash, uint64_t sourceSize, Parser::ASTNode *root);
+    void log(const std::string& message, const std::string& extra="");
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef _VM_H
+#define _VM_H
+
+#include "Bytecode.h"
+#include <string>
+#include <vector>
+
+class Interpreter;
+
+// Stack based virtual machine running compiled programs. Globals are shared with
+// the interpreter that owns it.
+class VM {
+public:
+    explicit VM(Interpreter& interpreter);
+    void run(const Program& program, std::vector<Value>& globals);
+
+private:
+    class CallFrame {
+    public:
+        const Function *function;
+        const Instruction *returnAddress;
+        Value *base; // First local slot of the frame.
+    };
+    Interpreter &interpreter;
+    std::vector<Value> stack;
+    std::vector<CallFrame> frames;
+    static void error(const std::string& message, const std::string& extra="");
+};
+
+#endif
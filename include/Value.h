@@ -0,0 +1,230 @@
+#ifndef _VALUE_H
+#define _VALUE_H
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Array;
+
+// A runtime value: a small tagged union. Numbers and booleans are stored inline,
+// strings and arrays are reference counted and shared between copies.
+class Value {
+    friend class Jit; // Native code reads and writes numbers in place.
+public:
+    enum Type {
+        UNDEFINED,
+        BOOL,
+        INT,
+        REAL,
+        STRING,
+        ARRAY
+    };
+
+    Value();
+    Value(const Value& other);
+    Value(Value&& other) noexcept;
+    Value& operator=(const Value& other);
+    Value& operator=(Value&& other) noexcept;
+    ~Value();
+
+    static Value boolean(bool b);
+    static Value integer(int64_t i);
+    static Value real(double d);
+    static Value string(const std::string& s);
+    static Value array(Array *array); // Arrays are references: copies share the elements.
+
+    Type getType() const { return type; }
+    bool isUndefined() const { return type == UNDEFINED; }
+    bool isNumber() const { return type == INT || type == REAL; }
+    bool isString() const { return type == STRING; }
+    bool isArray() const { return type == ARRAY; }
+
+    bool getBool() const { return as.b; }
+    int64_t getInt() const { return as.i; }
+    double getReal() const { return as.d; }
+    const std::string& getString() const;
+    Array *getArray() const { return as.a; }
+
+    bool toBool() const; // Truthiness used by conditions.
+    double toReal() const; // Numeric conversion, NaN if not a number.
+    std::string toString() const;
+
+    // Operators shared by the execution engines.
+    static Value add(const Value& left, const Value& right);
+    static Value subtract(const Value& left, const Value& right);
+    static Value multiply(const Value& left, const Value& right);
+    static Value divide(const Value& left, const Value& right);
+    static Value modulo(const Value& left, const Value& right);
+    static Value negate(const Value& value);
+    // Two integers stay an integer, unless the result overflows or, for a division, has a
+    // fraction: then it is the real the operator gives for the integers as reals.
+    static Value addIntegers(int64_t left, int64_t right);
+    static Value subtractIntegers(int64_t left, int64_t right);
+    static Value multiplyIntegers(int64_t left, int64_t right);
+    static Value divideIntegers(int64_t left, int64_t right);
+    static Value moduloIntegers(int64_t left, int64_t right);
+    static bool equals(const Value& left, const Value& right);
+    static bool less(const Value& left, const Value& right);
+    static bool lessEqual(const Value& left, const Value& right);
+
+private:
+    struct StringObject {
+        unsigned refs;
+        std::string data;
+    };
+    Type type;
+    union {
+        bool b;
+        int64_t i;
+        double d;
+        StringObject *s;
+        Array *a;
+    } as;
+    void retain();
+    void release();
+};
+
+// Heap storage of an array. Every array is registered with the Collector, which
+// frees the reference cycles that reference counting alone cannot. The elements live
+// in a buffer that copies share until one of them writes to it.
+class Array {
+    friend class Collector;
+public:
+    static const size_t MAX_SIZE = (size_t) 1 << 26; // Writing past the end grows an array up to this.
+    unsigned refs = 0;
+    explicit Array(std::vector<Value> elements);
+    explicit Array(const Array *source); // Copy sharing the source's buffer.
+    ~Array();
+    Array(const Array&) = delete;
+    Array& operator=(const Array&) = delete;
+    const std::vector<Value>& elements() const { return buffer->elements; }
+    std::vector<Value>& mutableElements(); // Unshares the buffer before handing it out.
+
+private:
+    class Buffer {
+    public:
+        unsigned refs;
+        std::vector<Value> elements;
+        unsigned gcSharers; // Garbage arrays sharing the buffer, during a collection.
+        bool scanned;
+    };
+    Buffer *buffer;
+    Array *previous; // Neighbours in the collector's list of live arrays.
+    Array *next;
+    unsigned gcRefs = 0; // References left after removing those coming from arrays.
+    bool marked = false;
+    void unshare();
+};
+
+inline std::vector<Value> &Array::mutableElements() {
+    if (buffer->refs > 1) unshare();
+    return buffer->elements;
+}
+
+// The copy and lifetime operations are on every hot path of both engines, keep them inline.
+
+inline Value::Value() {
+    type = UNDEFINED;
+    as.i = 0;
+}
+
+inline Value::Value(const Value &other) {
+    type = other.type;
+    as = other.as;
+    retain();
+}
+
+inline Value::Value(Value &&other) noexcept {
+    type = other.type;
+    as = other.as;
+    other.type = UNDEFINED;
+}
+
+inline Value &Value::operator=(const Value &other) {
+    if (this != &other) {
+        Value copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+inline Value &Value::operator=(Value &&other) noexcept {
+    if (this != &other) {
+        release();
+        type = other.type;
+        as = other.as;
+        other.type = UNDEFINED;
+    }
+    return *this;
+}
+
+inline Value::~Value() {
+    release();
+}
+
+inline void Value::retain() {
+    if (type == STRING) as.s->refs++;
+    else if (type == ARRAY) as.a->refs++;
+}
+
+inline void Value::release() {
+    if (type == STRING && --as.s->refs == 0) delete as.s;
+    else if (type == ARRAY && --as.a->refs == 0) delete as.a;
+    type = UNDEFINED;
+}
+
+inline Value Value::boolean(bool b) {
+    Value value;
+    value.type = BOOL;
+    value.as.b = b;
+    return value;
+}
+
+inline Value Value::integer(int64_t i) {
+    Value value;
+    value.type = INT;
+    value.as.i = i;
+    return value;
+}
+
+inline Value Value::real(double d) {
+    Value value;
+    value.type = REAL;
+    value.as.d = d;
+    return value;
+}
+
+inline Value Value::addIntegers(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_add_overflow(left, right, &result)) return real((double) left + (double) right);
+    return integer(result);
+}
+
+inline Value Value::subtractIntegers(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_sub_overflow(left, right, &result)) return real((double) left - (double) right);
+    return integer(result);
+}
+
+inline Value Value::multiplyIntegers(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_mul_overflow(left, right, &result)) return real((double) left * (double) right);
+    return integer(result);
+}
+
+inline Value Value::divideIntegers(int64_t left, int64_t right) {
+    if (right != 0 && !(left == INT64_MIN && right == -1) && left % right == 0) return integer(left / right);
+    return real((double) left / (double) right);
+}
+
+// The remainder has the sign of the dividend, like fmod. By zero it is NaN.
+inline Value Value::moduloIntegers(int64_t left, int64_t right) {
+    if (right == 0) return real(NAN);
+    if (right == -1) return integer(0); // INT64_MIN % -1 overflows.
+    return integer(left % right);
+}
+
+#endif
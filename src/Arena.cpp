@@ -0,0 +1,82 @@
+#include "Arena.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+static const size_t BLOCK_SIZE = 64 * 1024;
+
+Arena::Arena() {
+    blocks = nullptr;
+    position = end = nullptr;
+    bytesUsed = 0;
+    finalizers = nullptr;
+}
+
+Arena::~Arena() {
+    release();
+    free(blocks);
+}
+
+void Arena::addBlock(size_t minimum) {
+    size_t size = minimum > BLOCK_SIZE ? minimum : BLOCK_SIZE;
+    auto *block = static_cast<Block *>(malloc(sizeof(Block) + size));
+    if (block == nullptr) throw bad_alloc();
+    block->size = size;
+    block->next = blocks;
+    blocks = block;
+    position = block->data();
+    end = position + size;
+}
+
+void *Arena::allocate(size_t size, size_t align) {
+    auto address = reinterpret_cast<uintptr_t>(position);
+    size_t padding = (align - address % align) % align;
+    if (position == nullptr || padding + size > (size_t) (end - position)) {
+        addBlock(size + align);
+        address = reinterpret_cast<uintptr_t>(position);
+        padding = (align - address % align) % align;
+    }
+    char *result = position + padding;
+    position = result + size;
+    bytesUsed += size;
+    return result;
+}
+
+const char *Arena::copyString(string_view str) {
+    auto *copy = static_cast<char *>(allocate(str.size() + 1, 1));
+    memcpy(copy, str.data(), str.size());
+    copy[str.size()] = '\0';
+    return copy;
+}
+
+void Arena::addFinalizer(void *object, void (*destroy)(void *)) {
+    auto *finalizer = static_cast<Finalizer *>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+    finalizer->destroy = destroy;
+    finalizer->object = object;
+    finalizer->next = finalizers;
+    finalizers = finalizer;
+}
+
+// Destroy everything allocated so far. The oldest block is kept and reused.
+void Arena::release() {
+    for (Finalizer *finalizer = finalizers; finalizer != nullptr; finalizer = finalizer->next) {
+        finalizer->destroy(finalizer->object);
+    }
+    finalizers = nullptr;
+    while (blocks != nullptr && blocks->next != nullptr) {
+        Block *next = blocks->next;
+        free(blocks);
+        blocks = next;
+    }
+    if (blocks != nullptr) {
+        position = blocks->data();
+        end = position + blocks->size;
+    }
+    bytesUsed = 0;
+}
+
+size_t Arena::getBytesUsed() const {
+    return bytesUsed;
+}
@@ -0,0 +1,278 @@
+#include "Assembler.h"
+#include <cassert>
+
+using namespace std;
+
+Assembler::Label Assembler::newLabel() {
+    labels.push_back(-1);
+    return (Label) labels.size() - 1;
+}
+
+void Assembler::bind(Label label) {
+    assert(labels[label] == -1);
+    labels[label] = (long) code.size();
+}
+
+void Assembler::jump(Label label) {
+    emit(0xE9);
+    fixups.push_back({code.size(), label});
+    emit32(0);
+}
+
+void Assembler::jump(Condition condition, Label label) {
+    emit(0x0F);
+    emit(0x80 + condition);
+    fixups.push_back({code.size(), label});
+    emit32(0);
+}
+
+void Assembler::push(Register reg) {
+    emit(0x50 + reg);
+}
+
+void Assembler::pop(Register reg) {
+    emit(0x58 + reg);
+}
+
+void Assembler::ret() {
+    emit(0xC3);
+}
+
+void Assembler::call(Register target) {
+    emit(0xFF);
+    modrm(3, 2, target);
+}
+
+void Assembler::move(Register destination, Register source) {
+    rexWide();
+    emit(0x89);
+    modrm(3, source, destination);
+}
+
+void Assembler::move(Register destination, uint64_t immediate) {
+    rexWide();
+    emit(0xB8 + destination);
+    emit64(immediate);
+}
+
+void Assembler::load(Register destination, Register base, int32_t offset) {
+    rexWide();
+    emit(0x8B);
+    memory(destination, base, offset);
+}
+
+void Assembler::store(Register base, int32_t offset, Register source) {
+    rexWide();
+    emit(0x89);
+    memory(source, base, offset);
+}
+
+void Assembler::store32(Register base, int32_t offset, uint32_t immediate) {
+    emit(0xC7);
+    memory(0, base, offset);
+    emit32(immediate);
+}
+
+void Assembler::loadByte(Register destination, Register base, int32_t offset) {
+    emit(0x0F);
+    emit(0xB6);
+    memory(destination, base, offset);
+}
+
+void Assembler::add(Register destination, Register source) {
+    rexWide();
+    emit(0x01);
+    modrm(3, source, destination);
+}
+
+void Assembler::add(Register destination, int32_t immediate) {
+    rexWide();
+    emit(0x81);
+    modrm(3, 0, destination);
+    emit32((uint32_t) immediate);
+}
+
+void Assembler::subtract(Register destination, Register source) {
+    rexWide();
+    emit(0x29);
+    modrm(3, source, destination);
+}
+
+void Assembler::subtract(Register destination, int32_t immediate) {
+    rexWide();
+    emit(0x81);
+    modrm(3, 5, destination);
+    emit32((uint32_t) immediate);
+}
+
+void Assembler::multiply(Register destination, Register source) {
+    rexWide();
+    emit(0x0F);
+    emit(0xAF);
+    modrm(3, destination, source);
+}
+
+void Assembler::negate(Register reg) {
+    rexWide();
+    emit(0xF7);
+    modrm(3, 3, reg);
+}
+
+void Assembler::signExtend() {
+    rexWide();
+    emit(0x99);
+}
+
+void Assembler::divide(Register divisor) {
+    rexWide();
+    emit(0xF7);
+    modrm(3, 7, divisor);
+}
+
+void Assembler::compare(Register left, Register right) {
+    rexWide();
+    emit(0x39);
+    modrm(3, right, left);
+}
+
+void Assembler::test(Register left, Register right) {
+    rexWide();
+    emit(0x85);
+    modrm(3, right, left);
+}
+
+void Assembler::compare32(Register base, int32_t offset, uint32_t immediate) {
+    emit(0x81);
+    memory(7, base, offset);
+    emit32(immediate);
+}
+
+void Assembler::shiftLeft(Register reg, uint8_t count) {
+    rexWide();
+    emit(0xC1);
+    modrm(3, 4, reg);
+    emit(count);
+}
+
+void Assembler::shiftRight(Register reg, uint8_t count) {
+    rexWide();
+    emit(0xC1);
+    modrm(3, 5, reg);
+    emit(count);
+}
+
+// setcc writes the low byte only, movzx clears the rest.
+void Assembler::set(Condition condition, Register destination) {
+    assert(destination <= RBX); // Other low bytes need a REX prefix.
+    emit(0x0F);
+    emit(0x90 + condition);
+    modrm(3, 0, destination);
+    emit(0x0F);
+    emit(0xB6);
+    modrm(3, destination, destination);
+}
+
+void Assembler::loadDouble(int destination, Register base, int32_t offset) {
+    emit(0xF2);
+    emit(0x0F);
+    emit(0x10);
+    memory(destination, base, offset);
+}
+
+void Assembler::storeDouble(Register base, int32_t offset, int source) {
+    emit(0xF2);
+    emit(0x0F);
+    emit(0x11);
+    memory(source, base, offset);
+}
+
+void Assembler::moveDouble(int destination, int source) {
+    sse(0x66, 0x28, destination, source);
+}
+
+void Assembler::moveToDouble(int destination, Register source) {
+    sse(0x66, 0x6E, destination, source, true);
+}
+
+void Assembler::convertToDouble(int destination, Register source) {
+    sse(0xF2, 0x2A, destination, source, true);
+}
+
+void Assembler::truncateToInteger(Register destination, int source) {
+    sse(0xF2, 0x2C, destination, source, true);
+}
+
+void Assembler::addDouble(int destination, int source) {
+    sse(0xF2, 0x58, destination, source);
+}
+
+void Assembler::subtractDouble(int destination, int source) {
+    sse(0xF2, 0x5C, destination, source);
+}
+
+void Assembler::multiplyDouble(int destination, int source) {
+    sse(0xF2, 0x59, destination, source);
+}
+
+void Assembler::divideDouble(int destination, int source) {
+    sse(0xF2, 0x5E, destination, source);
+}
+
+void Assembler::xorDouble(int destination, int source) {
+    sse(0x66, 0x57, destination, source);
+}
+
+void Assembler::compareDouble(int left, int right) {
+    sse(0x66, 0x2E, left, right);
+}
+
+size_t Assembler::size() const {
+    return code.size();
+}
+
+vector<uint8_t> Assembler::finish() {
+    for (const Fixup &fixup : fixups) {
+        assert(labels[fixup.label] != -1);
+        auto offset = (int32_t) (labels[fixup.label] - (long) (fixup.position + 4));
+        for (int i = 0; i < 4; ++i) code[fixup.position + i] = (uint8_t) ((uint32_t) offset >> (8 * i));
+    }
+    fixups.clear();
+    return code;
+}
+
+void Assembler::emit(uint8_t byte) {
+    code.push_back(byte);
+}
+
+void Assembler::emit32(uint32_t value) {
+    for (int i = 0; i < 4; ++i) emit((uint8_t) (value >> (8 * i)));
+}
+
+void Assembler::emit64(uint64_t value) {
+    for (int i = 0; i < 8; ++i) emit((uint8_t) (value >> (8 * i)));
+}
+
+// REX.W alone: with registers 0 to 7 only, REX.R and REX.B are never needed.
+void Assembler::rexWide() {
+    emit(0x48);
+}
+
+void Assembler::modrm(int mod, int reg, int rm) {
+    emit((uint8_t) ((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+}
+
+// [base + disp32]. RSP as a base needs a SIB byte.
+void Assembler::memory(int reg, Register base, int32_t offset) {
+    modrm(2, reg, base);
+    if (base == RSP) emit(0x24);
+    emit32((uint32_t) offset);
+}
+
+// The mandatory prefix goes before REX.
+void Assembler::sse(uint8_t prefix, uint8_t opcode, int reg, int rm, bool wide) {
+    emit(prefix);
+    if (wide) rexWide();
+    emit(0x0F);
+    emit(opcode);
+    modrm(3, reg, rm);
+}
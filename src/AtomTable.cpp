@@ -0,0 +1,36 @@
+#include "AtomTable.h"
+
+using namespace std;
+
+AtomTable::Table::Table() {
+    names.emplace_back();
+    ids.insert({names.back(), NO_ATOM});
+    for (const char *builtin : {"input", "output"}) {
+        names.emplace_back(builtin);
+        ids.insert({names.back(), (Atom) (names.size() - 1)});
+    }
+}
+
+// Constructed on first use, so atoms can be interned from any static initializer.
+AtomTable::Table &AtomTable::table() {
+    static Table instance;
+    return instance;
+}
+
+AtomTable::Atom AtomTable::intern(string_view name) {
+    Table &t = table();
+    auto iter = t.ids.find(name);
+    if (iter != t.ids.end()) return iter->second;
+    auto atom = (Atom) t.names.size();
+    t.names.emplace_back(name);
+    t.ids.insert({t.names.back(), atom});
+    return atom;
+}
+
+const string &AtomTable::name(Atom atom) {
+    return table().names[atom];
+}
+
+size_t AtomTable::size() {
+    return table().names.size();
+}
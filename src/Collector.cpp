@@ -0,0 +1,145 @@
+#include "Collector.h"
+#include <iostream>
+
+using namespace std;
+
+static const size_t INITIAL_THRESHOLD = 1024;
+
+Array *Collector::arrays = nullptr;
+size_t Collector::threshold = INITIAL_THRESHOLD;
+Collector::Stats Collector::stats;
+bool Collector::debug = false;
+
+Array::Array(std::vector<Value> elements) {
+    buffer = new Buffer{1, std::move(elements), 0, false};
+    Collector::track(this);
+}
+
+Array::Array(const Array *source) {
+    buffer = source->buffer;
+    buffer->refs++;
+    Collector::track(this);
+}
+
+Array::~Array() {
+    if (--buffer->refs == 0) delete buffer;
+    Collector::untrack(this);
+}
+
+// Give this array its own copy of a shared buffer.
+void Array::unshare() {
+    Buffer *copy = new Buffer{1, buffer->elements, 0, false};
+    buffer->refs--;
+    buffer = copy;
+}
+
+void Collector::track(Array *array) {
+    array->previous = nullptr;
+    array->next = arrays;
+    if (arrays != nullptr) arrays->previous = array;
+    arrays = array;
+    stats.allocated++;
+    if (++stats.live > stats.peak) stats.peak = stats.live;
+}
+
+void Collector::untrack(Array *array) {
+    if (array->previous != nullptr) array->previous->next = array->next;
+    else arrays = array->next;
+    if (array->next != nullptr) array->next->previous = array->previous;
+    stats.live--;
+}
+
+Value Collector::newArray(std::vector<Value> elements) {
+    if (stats.live >= threshold) {
+        collect();
+        threshold = max(INITIAL_THRESHOLD, stats.live * 2);
+    }
+    return Value::array(new Array(std::move(elements)));
+}
+
+Value Collector::newArray(const Array *source) {
+    if (stats.live >= threshold) {
+        collect();
+        threshold = max(INITIAL_THRESHOLD, stats.live * 2);
+    }
+    return Value::array(new Array(source));
+}
+
+size_t Collector::collect() {
+    // Subtract the references held by element buffers.
+    for (Array *array = arrays; array != nullptr; array = array->next) {
+        array->gcRefs = array->refs;
+        array->marked = false;
+        array->buffer->gcSharers = 0;
+        array->buffer->scanned = false;
+    }
+    for (Array *array = arrays; array != nullptr; array = array->next) {
+        if (array->buffer->scanned) continue;
+        array->buffer->scanned = true;
+        for (const Value &element : array->buffer->elements) {
+            if (element.isArray()) element.getArray()->gcRefs--;
+        }
+    }
+    // Mark everything reachable from the arrays still referenced from outside.
+    vector<Array *> pending;
+    for (Array *array = arrays; array != nullptr; array = array->next) {
+        if (array->gcRefs > 0 && !array->marked) {
+            array->marked = true;
+            pending.push_back(array);
+        }
+        while (!pending.empty()) {
+            Array *current = pending.back();
+            pending.pop_back();
+            for (const Value &element : current->buffer->elements) {
+                if (!element.isArray()) continue;
+                Array *child = element.getArray();
+                if (!child->marked) {
+                    child->marked = true;
+                    pending.push_back(child);
+                }
+            }
+        }
+    }
+    // Unmarked arrays are only referenced by each other. Hold them while their buffers
+    // are cleared, so that reference counting does not free any of them halfway. A buffer
+    // still shared with a live array is left alone: its elements are all marked.
+    vector<Array *> garbage;
+    for (Array *array = arrays; array != nullptr; array = array->next) {
+        if (!array->marked) {
+            array->refs++;
+            array->buffer->gcSharers++;
+            garbage.push_back(array);
+        }
+    }
+    for (Array *array : garbage) {
+        if (array->buffer->gcSharers == array->buffer->refs) array->buffer->elements.clear();
+    }
+    for (Array *array : garbage) {
+        delete array;
+    }
+    stats.collections++;
+    stats.freed += garbage.size();
+    log("freed " + to_string(garbage.size()) + " arrays, live: ", to_string(stats.live));
+    return garbage.size();
+}
+
+const Collector::Stats &Collector::getStats() {
+    return stats;
+}
+
+void Collector::report() {
+    cout << "[Collector] live arrays: " << stats.live
+         << ", peak: " << stats.peak
+         << ", allocated: " << stats.allocated
+         << ", collections: " << stats.collections
+         << ", freed by collector: " << stats.freed << endl;
+}
+
+void Collector::setDebugMode(bool enable) {
+    debug = enable;
+}
+
+void Collector::log(const string &message, const std::string &extra) {
+    if (!debug) return;
+    cout << "[Collector] [Log]: " << message << extra << endl;
+}
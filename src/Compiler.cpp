@@ -0,0 +1,363 @@
+#include "Compiler.h"
+#include <iostream>
+#include <cassert>
+
+using namespace std;
+
+Program Compiler::compile(Parser::ASTNode *root) {
+    Program result;
+    program = &result;
+    functionIndex.clear();
+    declarations.clear();
+    result.functions.emplace_back();
+    result.functions[0].name = "main";
+    declarations.push_back(nullptr);
+    // Function declarations are hoisted, so every call site can refer to its target by index.
+    collectFunctions(root);
+    // Top-level code: its frame only holds the scopes of top-level loops.
+    function = &program->functions[0];
+    scopeBases.clear();
+    frameOffset = 0;
+    compileStatementList(root);
+    emit(OP_HALT);
+    for (int i = 1; i < (int) declarations.size(); ++i) {
+        compileFunction(declarations[i], i);
+    }
+    program = nullptr;
+    function = nullptr;
+    return result;
+}
+
+void Compiler::setDebugMode(bool enable) {
+    debug = enable;
+}
+
+void Compiler::error(const string &message, const std::string &extra) {
+    cerr << "[Compiler] [Error]: " << message << extra << endl;
+    exit(-1);
+}
+
+void Compiler::log(const string &message, const std::string &extra) {
+    if (!debug) return;
+    cout << "[Compiler] [Log]: " << message << extra << endl;
+}
+
+// Register every function declaration, wherever it appears. The first declaration of a name wins.
+void Compiler::collectFunctions(Parser::ASTNode *node) {
+    for (; node != nullptr; node = node->next) {
+        if (node->type == Parser::FUNCTION_DECLARE_NODE) {
+            if (functionIndex.find(node->atom) == functionIndex.end()) {
+                functionIndex[node->atom] = (int) program->functions.size();
+                program->functions.emplace_back();
+                program->functions.back().name = node->text;
+                for (auto *argument = node->child[0]; argument != nullptr; argument = argument->next) {
+                    program->functions.back().arity++;
+                }
+                declarations.push_back(node);
+            } else {
+                log("define a function multiple times: ", node->text);
+            }
+        }
+        for (auto *child : node->child) {
+            collectFunctions(child);
+        }
+    }
+}
+
+void Compiler::compileFunction(Parser::ASTNode *node, int index) {
+    function = &program->functions[index];
+    scopeBases.clear();
+    frameOffset = 0;
+    enterScope(node->scopeSize);
+    compileStatementList(node->child[1]);
+    exitScope(node->scopeSize);
+    emit(OP_UNDEFINED);
+    emit(OP_RETURN);
+    log("compiled function ", function->name + " (" + to_string(function->code.size()) + " instructions)");
+}
+
+// Loop scopes of size 0 were elided by the resolver and are not counted in depths.
+void Compiler::enterBlockScope(int size) {
+    if (size > 0) enterScope(size);
+}
+
+void Compiler::exitBlockScope(int size) {
+    if (size > 0) exitScope(size);
+}
+
+// The walker gives every iteration a fresh body scope: clear its slots, so the
+// declarations of one iteration are not seen by the next.
+void Compiler::enterLoopBody(int size) {
+    if (size == 0) return;
+    enterScope(size);
+    emit(OP_CLEAR_LOCALS, scopeBases.back(), size);
+}
+
+void Compiler::enterScope(int size) {
+    scopeBases.push_back(frameOffset);
+    frameOffset += size;
+    if (frameOffset > function->numLocals) function->numLocals = frameOffset;
+}
+
+void Compiler::exitScope(int size) {
+    frameOffset -= size;
+    scopeBases.pop_back();
+}
+
+int Compiler::emit(OpCode op, int a, int b) {
+    function->code.push_back({op, a, b});
+    return (int) function->code.size() - 1;
+}
+
+// Point the jump at instruction `at` to `target`.
+void Compiler::patch(int at, int target) {
+    function->code[at].a = target;
+}
+
+int Compiler::here() const {
+    return (int) function->code.size();
+}
+
+int Compiler::addConstant(const Value &value) {
+    program->constants.push_back(value);
+    return (int) program->constants.size() - 1;
+}
+
+// A resolved depth inside the open scopes of the current function is a local,
+// anything further out is a global.
+void Compiler::emitLoad(Parser::ASTNode *node) {
+    int open = (int) scopeBases.size();
+    if (node->depth < open) {
+        emit(OP_LOAD_LOCAL, scopeBases[open - 1 - node->depth] + node->slot);
+    } else {
+        emit(OP_LOAD_GLOBAL, node->slot);
+    }
+}
+
+void Compiler::emitStore(Parser::ASTNode *node) {
+    int open = (int) scopeBases.size();
+    if (node->depth < open) {
+        emit(OP_STORE_LOCAL, scopeBases[open - 1 - node->depth] + node->slot);
+    } else {
+        emit(OP_STORE_GLOBAL, node->slot);
+    }
+}
+
+void Compiler::compileStatementList(Parser::ASTNode *node) {
+    for (; node != nullptr; node = node->next) {
+        compileStatement(node);
+    }
+}
+
+void Compiler::compileStatement(Parser::ASTNode *node) {
+    switch (node->type) {
+        case Parser::NONE:
+        case Parser::FUNCTION_DECLARE_NODE:
+            break;
+        case Parser::VAR_DECLARE_NODE:
+            compileExpression(node->child[0]);
+            emitStore(node);
+            break;
+        case Parser::VAR_ASSIGN_NODE:
+            if (node->child[1] != nullptr) {
+                emitLoad(node);
+                compileExpression(node->child[1]);
+                compileExpression(node->child[0]);
+                emit(OP_STORE_ELEMENT);
+            } else {
+                compileExpression(node->child[0]);
+                emitStore(node);
+            }
+            break;
+        case Parser::IF_NODE: {
+            compileExpression(node->child[0]);
+            int toElse = emit(OP_JUMP_IF_FALSE);
+            compileStatementList(node->child[1]);
+            if (node->child[2] != nullptr) {
+                int toEnd = emit(OP_JUMP);
+                patch(toElse, here());
+                compileStatementList(node->child[2]);
+                patch(toEnd, here());
+            } else {
+                patch(toElse, here());
+            }
+            break;
+        }
+        case Parser::WHILE_NODE: {
+            enterBlockScope(node->scopeSize);
+            int start = here();
+            compileExpression(node->child[0]);
+            int toEnd = emit(OP_JUMP_IF_FALSE);
+            enterLoopBody(node->bodyScopeSize);
+            loops.emplace_back();
+            compileStatementList(node->child[1]);
+            exitBlockScope(node->bodyScopeSize);
+            emit(OP_JUMP, start);
+            patch(toEnd, here());
+            patchJumps(loops.back().continues, start);
+            patchJumps(loops.back().breaks, here());
+            loops.pop_back();
+            exitBlockScope(node->scopeSize);
+            break;
+        }
+        case Parser::FOR_NODE: {
+            enterBlockScope(node->scopeSize);
+            if (node->child[0] != nullptr) compileStatement(node->child[0]); // Initialization
+            int start = here();
+            compileExpression(node->child[1]); // Condition
+            int toEnd = emit(OP_JUMP_IF_FALSE);
+            enterLoopBody(node->bodyScopeSize);
+            loops.emplace_back();
+            compileStatementList(node->child[3]); // Body
+            exitBlockScope(node->bodyScopeSize);
+            patchJumps(loops.back().continues, here());
+            if (node->child[2] != nullptr) compileStatement(node->child[2]); // Update
+            emit(OP_JUMP, start);
+            patch(toEnd, here());
+            patchJumps(loops.back().breaks, here());
+            loops.pop_back();
+            exitBlockScope(node->scopeSize);
+            break;
+        }
+        case Parser::RETURN_NODE:
+            if (function == &program->functions[0]) {
+                // A return at the top level ends the program.
+                compileExpression(node->child[0]);
+                emit(OP_POP);
+                emit(OP_HALT);
+            } else if (node->isTailCall) {
+                Parser::ASTNode *call = node->child[0];
+                compileCall(call->type == Parser::EXPRESSION_NODE ? call->child[0] : call, true);
+            } else {
+                compileExpression(node->child[0]);
+                emit(OP_RETURN);
+            }
+            break;
+        case Parser::BREAK_NODE:
+        case Parser::CONTINUE_NODE:
+            if (loops.empty()) error("jump statement outside of a loop: ", node->text);
+            if (node->type == Parser::BREAK_NODE) {
+                loops.back().breaks.push_back(emit(OP_JUMP));
+            } else {
+                loops.back().continues.push_back(emit(OP_JUMP));
+            }
+            break;
+        default:
+            // Expression statement.
+            compileExpression(node);
+            emit(OP_POP);
+            break;
+    }
+}
+
+void Compiler::compileExpression(Parser::ASTNode *node) {
+    if (node == nullptr) {
+        emit(OP_UNDEFINED);
+        return;
+    }
+    switch (node->type) {
+        case Parser::EXPRESSION_NODE:
+            compileExpression(node->child[0]);
+            break;
+        case Parser::INT_NODE:
+        case Parser::REAL_NODE:
+        case Parser::STRING_NODE:
+        case Parser::CHAR_NODE:
+        case Parser::BOOL_NODE:
+            emit(OP_CONSTANT, addConstant(node->value));
+            break;
+        case Parser::VAR_NODE:
+            emitLoad(node);
+            break;
+        case Parser::NEGATIVE_NODE:
+            compileExpression(node->child[0]);
+            emit(OP_NEGATE);
+            break;
+        case Parser::BINARY_OPERATOR_NODE: {
+            if (node->op == Parser::OP_AND || node->op == Parser::OP_OR) {
+                compileLogical(node);
+                break;
+            }
+            compileExpression(node->child[0]);
+            compileExpression(node->child[1]);
+            static const OpCode opCodes[] = {
+                OP_HALT, // Parser::OP_NONE
+                OP_ADD, OP_SUBTRACT, OP_MULTIPLY, OP_DIVIDE, OP_MODULO,
+                OP_LESS, OP_LESS_EQUAL, OP_GREATER, OP_GREATER_EQUAL, OP_EQUAL, OP_NOT_EQUAL
+            };
+            if (node->op == Parser::OP_NONE) error("unexpected operator: ", node->text);
+            emit(opCodes[node->op]);
+            break;
+        }
+        case Parser::ARRAY_DECLARE_NODE: {
+            int count = 0;
+            for (auto *element = node->child[0]; element != nullptr; element = element->next) {
+                compileExpression(element);
+                count++;
+            }
+            emit(OP_NEW_ARRAY, count);
+            break;
+        }
+        case Parser::ARRAY_ACCESS_NODE:
+            emitLoad(node);
+            compileExpression(node->child[0]);
+            emit(OP_LOAD_ELEMENT);
+            break;
+        case Parser::FUNCTION_CALL_NODE:
+            compileCall(node);
+            break;
+        default:
+            error("unexpected node type in expression: ", to_string(node->type));
+    }
+}
+
+// && and || only evaluate their right operand if the left one does not decide the result.
+// Like the other operators they produce a boolean.
+void Compiler::compileLogical(Parser::ASTNode *node) {
+    bool isAnd = node->op == Parser::OP_AND;
+    compileExpression(node->child[0]);
+    int toRight = -1;
+    int toFalse = emit(OP_JUMP_IF_FALSE);
+    if (!isAnd) {
+        // A truthy left operand decides ||, a falsy one moves on to the right operand.
+        emit(OP_CONSTANT, addConstant(Value::boolean(true)));
+        toRight = emit(OP_JUMP);
+        patch(toFalse, here());
+    }
+    compileExpression(node->child[1]);
+    int toFalseRight = emit(OP_JUMP_IF_FALSE);
+    emit(OP_CONSTANT, addConstant(Value::boolean(true)));
+    int toEnd = emit(OP_JUMP);
+    if (isAnd) patch(toFalse, here());
+    patch(toFalseRight, here());
+    emit(OP_CONSTANT, addConstant(Value::boolean(false)));
+    patch(toEnd, here());
+    if (toRight >= 0) patch(toRight, here());
+}
+
+void Compiler::patchJumps(const vector<int> &jumps, int target) {
+    for (int jump : jumps) patch(jump, target);
+}
+
+void Compiler::compileCall(Parser::ASTNode *node, bool isTail) {
+    Parser::ASTNode *argument = node->child[0];
+    if (node->atom == AtomTable::INPUT) {
+        emit(OP_INPUT);
+        return;
+    }
+    if (node->atom == AtomTable::OUTPUT) {
+        compileExpression(argument);
+        emit(OP_OUTPUT);
+        return;
+    }
+    auto iter = functionIndex.find(node->atom);
+    if (iter == functionIndex.end()) error("call undefined function: ", node->text);
+    // Like the tree-walker, extra arguments are ignored and missing ones stay undefined.
+    int count = 0;
+    int arity = program->functions[iter->second].arity;
+    for (; argument != nullptr && count < arity; argument = argument->next) {
+        compileExpression(argument);
+        count++;
+    }
+    emit(isTail ? OP_TAIL_CALL : OP_CALL, iter->second, count);
+}
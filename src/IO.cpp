@@ -0,0 +1,53 @@
+#include "IO.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+using namespace std;
+
+static const size_t OUTPUT_BUFFER_SIZE = 1 << 16;
+static const size_t INPUT_BUFFER_SIZE = 1 << 16;
+
+char IO::input[INPUT_BUFFER_SIZE];
+size_t IO::inputStart = 0;
+size_t IO::inputEnd = 0;
+bool IO::unbuffered = false;
+
+void IO::init(bool enable) {
+    unbuffered = enable;
+    if (unbuffered) {
+        setvbuf(stdout, nullptr, _IONBF, 0);
+    } else {
+        setvbuf(stdout, nullptr, isatty(STDOUT_FILENO) ? _IOLBF : _IOFBF, OUTPUT_BUFFER_SIZE);
+    }
+}
+
+void IO::write(string_view text) {
+    fwrite(text.data(), 1, text.size(), stdout);
+}
+
+void IO::flush() {
+    fflush(stdout);
+}
+
+// Whatever was printed before, a prompt for instance, has to be visible before blocking on input.
+bool IO::readLine(string &line) {
+    flush();
+    line.clear();
+    while (true) {
+        const char *start = input + inputStart;
+        const auto *newline = static_cast<const char *>(memchr(start, '\n', inputEnd - inputStart));
+        if (newline != nullptr) {
+            line.append(start, newline - start);
+            inputStart = newline - input + 1;
+            return true;
+        }
+        line.append(start, inputEnd - inputStart);
+        inputStart = inputEnd = 0;
+        ssize_t count = read(STDIN_FILENO, input, INPUT_BUFFER_SIZE);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return !line.empty(); // The last line may have no newline.
+        inputEnd = (size_t) count;
+    }
+}
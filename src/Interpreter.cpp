@@ -1,22 +1,103 @@
 #include "Interpreter.h"
+#include "Collector.h"
+#include "Compiler.h"
+#include "IO.h"
+#include "Jit.h"
+#include "Optimizer.h"
+#include "Purity.h"
+#include "ScriptCache.h"
+#include "VM.h"
 #include <iostream>
 #include <cassert>
+#include <cmath>
 #include <iomanip>
 #include <ctime>
 
 using namespace std;
 
+static const int MAX_DESPECIALIZATIONS = 4;
+
 Interpreter::Interpreter() {
-    variableTable.push_back(new map<string, Variable>);
-    scopeLevel = 0;
+    globals = new Frame(0, nullptr);
+    frame = globals;
     root = nullptr;
 }
 
+Interpreter::~Interpreter() {
+    delete globals;
+    for (auto *pooled : framePool) {
+        delete pooled;
+    }
+    Collector::collect(); // Cycles that were only reachable from the globals.
+}
+
 void Interpreter::interpretFile(string &filename) {
-    parser.parseFile(filename);
+    loadFile(filename);
+    run();
+}
+
+// Parse, optimize and resolve the script, ready for run().
+void Interpreter::loadFile(string &filename) {
+    if (cacheDirectory.empty()) {
+        parser.parseFile(filename);
+    } else {
+        ScriptCache cache(cacheDirectory);
+        cache.setDebugMode(debug);
+        cache.parseFile(filename, parser);
+    }
     root = parser.getAST();
-    visitNode(root);
+    if (optimizationLevel > 0) {
+        Optimizer optimizer;
+        optimizer.setDebugMode(debug);
+        root = optimizer.optimize(root, true);
+    }
+    resolver.resolve(root);
+}
+
+void Interpreter::run() {
+    globals->slots.resize(resolver.getGlobalCount());
+    if (engine == BYTECODE_VM) {
+        if (!profileFile.empty()) error("profiling is only supported by the tree walker: ", "--engine=ast");
+        if (jitThreshold > 0) error("the JIT is only supported by the tree walker: ", "--engine=ast");
+        Compiler compiler;
+        compiler.setDebugMode(debug);
+        Program program = compiler.compile(root);
+        VM vm(*this);
+        vm.run(program, globals->slots);
+    } else {
+        if (memoize) {
+            Purity purity;
+            purity.setDebugMode(debug);
+            memoized = purity.analyze(root);
+            memoTables.resize(memoized.size());
+            for (size_t i = 0; i < memoized.size(); ++i) memoized[i]->memo = (int) i;
+        }
+        if (!profileFile.empty()) {
+            profiler.reset(new Profiler());
+            profiler->start();
+        }
+        if (jitThreshold > 0) {
+            jit = new Jit(jitThreshold);
+            jit->setDebugMode(debug);
+        }
+        visitStatementList(root);
+        completion = NORMAL; // A return at the top level ends the program.
+        if (jit != nullptr) {
+            if (jitStats) jit->report();
+            delete jit;
+            jit = nullptr;
+        }
+        if (memoize) reportMemoTables();
+        if (profiler != nullptr) {
+            profiler->stop();
+            if (!profiler->write(profileFile)) error("cannot write profile: ", profileFile);
+            log("profile: ", to_string(profiler->getSampleCount()) + " samples, " +
+                to_string(profiler->getDroppedCount()) + " dropped");
+            profiler.reset();
+        }
+    }
     printVariableTable();
+    if (gcStats) Collector::report();
 }
 
 void Interpreter::shell() {
@@ -26,12 +107,12 @@ void Interpreter::shell() {
         cout << "> ";
         string input;
         string line;
-        getline(cin, line);
+        if (!IO::readLine(line)) break; // End of input.
         if (!line.empty() && line[line.size() - 1] == '{') {
             do {
                 cout << "... ";
                 input += line;
-            } while (getline(cin, line) && (!line.empty())
+            } while (IO::readLine(line) && (!line.empty())
                      && line[line.size() - 1] != '}');
         }
         input += line;
@@ -46,6 +127,11 @@ bool Interpreter::shellExecute(const string &input) {
     } else if (input == ".show") {
         printVariableTable();
         return true;
+    } else if (input == ".gc") {
+        size_t freed = Collector::collect();
+        cout << "Freed " << freed << " arrays." << endl;
+        Collector::report();
+        return true;
     } else if (input == ".debug") {
         setDebugMode(true);
         cout << "Debug mode enabled." << endl;
@@ -54,14 +140,27 @@ bool Interpreter::shellExecute(const string &input) {
         cout << ".help     Print this help message\n"
              << ".exit     Exit the repl\n"
              << ".show     Print the variable table\n"
+             << ".gc       Collect unreachable arrays and print collector statistics\n"
              << ".debug    Enable debug mode\n"
              << endl
              << "Press ^C to exit the repl" << endl;
         return true;
     }
     Parser::ASTNode *node = parser.parseInput(input);
-    string output = visitNode(node);
-    cout << (output.empty() ? "undefined" : output) << endl;
+    if (optimizationLevel > 0) {
+        Optimizer optimizer;
+        optimizer.setDebugMode(debug);
+        node = optimizer.optimize(node, false);
+    }
+    resolver.resolve(node);
+    globals->slots.resize(resolver.getGlobalCount());
+    size_t functionCount = functionTable.size();
+    Value output = visitStatementList(node);
+    completion = NORMAL;
+    returnValue = Value();
+    cout << output.toString() << endl;
+    // The line's tree is released by the next parse, unless the function table now points into it.
+    if (functionTable.size() != functionCount) parser.keepAST();
     return true;
 }
 
@@ -82,99 +181,139 @@ void Interpreter::printVariableTable() {
          << "| " << std::left << setw(20) << "Value"
          << "| " << endl;
     cout << "+----+---------------------+" << endl;
-    for (int i = scopeLevel; i >= 0; --i) {
-        map<string, Variable> *scope = variableTable[i];
-        map<string, Interpreter::Variable>::iterator iter;
-        for (const auto &e : *scope) {
-            cout << "| " << std::left << setw(3) << e.first
-                 << "| " << std::left << setw(20) << e.second.value
-                 << "| " << endl;
-        }
-        cout << "+----+---------------------+" << endl;
+    for (const auto &e : resolver.getGlobals()) {
+        cout << "| " << std::left << setw(3) << e.first
+             << "| " << std::left << setw(20) << globals->slots[e.second].toString()
+             << "| " << endl;
     }
+    cout << "+----+---------------------+" << endl;
 }
 
 void Interpreter::setDebugMode(bool enable) {
     debug = enable;
     parser.setDebugMode(enable);
+    resolver.setDebugMode(enable);
+    Collector::setDebugMode(enable);
 }
 
-void Interpreter::enterScope() {
-    assert(variableTable.size() == scopeLevel + 1);
-    scopeLevel++;
-    variableTable.push_back(new map<string, Variable>);
+void Interpreter::setGcStats(bool enable) {
+    gcStats = enable;
 }
 
-void Interpreter::exitScope() {
-    scopeLevel--;
-    variableTable.pop_back();
-    assert(variableTable.size() == scopeLevel + 1);
+void Interpreter::setCacheDirectory(const std::string &directory) {
+    cacheDirectory = directory;
 }
 
-bool Interpreter::declareVariable(const std::string &name, const Variable &variable) {
-    map<string, Variable> *scope = variableTable[scopeLevel];
-    map<string, Variable>::iterator iter;
-    iter = scope->find(name);
-    if (iter != scope->end()) {
-        log("define a variable multiple times: ", name);
-    }
-    scope->insert({name, variable});
-    return true;
+void Interpreter::setOptimizationLevel(int level) {
+    optimizationLevel = level;
 }
 
-bool Interpreter::setVariableValue(const std::string &name, const Variable &variable) {
-    bool success = false;
-    for (int i = scopeLevel; i >= 0; --i) {
-        map<string, Variable> *scope = variableTable[i];
-        map<string, Interpreter::Variable>::iterator iter;
-        iter = scope->find(name);
-        if (iter != scope->end()) {
-            iter->second.value = variable.value;
-            success = true;
-            break;
-        }
+void Interpreter::setMemoize(bool enable) {
+    memoize = enable;
+}
+
+void Interpreter::setProfileFile(const std::string &filename) {
+    profileFile = filename;
+}
+
+void Interpreter::setJit(int threshold) {
+    jitThreshold = threshold;
+}
+
+void Interpreter::setJitStats(bool enable) {
+    jitStats = enable;
+}
+
+void Interpreter::reportMemoTables() {
+    for (size_t i = 0; i < memoized.size(); ++i) {
+        size_t hits = memoTables[i].getHits();
+        size_t calls = hits + memoTables[i].getMisses();
+        log("memo " + string(memoized[i]->text) + ": ", to_string(hits) + " hits in " + to_string(calls) +
+            " calls (" + to_string(calls > 0 ? hits * 100 / calls : 0) + "%)");
     }
-    return success;
 }
 
-string Interpreter::getVariableValue(const string &name) {
-    for (int i = scopeLevel; i >= 0; --i) {
-        map<string, Variable> *scope = variableTable[i];
-        map<string, Interpreter::Variable>::iterator iter;
-        iter = scope->find(name);
-        if (iter != scope->end()) {
-            return iter->second.value;
-        }
+void Interpreter::setEngine(Engine e) {
+    engine = e;
+}
+
+// Frames are recycled through a pool, so entering a scope does not allocate once
+// the pool is warm.
+Interpreter::Frame *Interpreter::newFrame(int size, Frame *parent) {
+    if (framePool.empty()) return new Frame(size, parent);
+    Frame *result = framePool.back();
+    framePool.pop_back();
+    result->slots.resize(size);
+    result->parent = parent;
+    return result;
+}
+
+void Interpreter::freeFrame(Frame *f) {
+    f->slots.clear();
+    framePool.push_back(f);
+}
+
+// Push a new frame linked to the given parent, return the frame to restore on exit.
+Interpreter::Frame *Interpreter::enterScope(int size, Frame *parent) {
+    Frame *previous = frame;
+    frame = newFrame(size, parent);
+    return previous;
+}
+
+void Interpreter::exitScope(Frame *previous) {
+    freeFrame(frame);
+    frame = previous;
+}
+
+// The slot a resolved variable node refers to.
+Value &Interpreter::variable(Parser::ASTNode *node) {
+    Frame *current = frame;
+    for (int i = node->depth; i > 0; --i) {
+        current = current->parent;
     }
-    log("use undefined variable: ", name);
-    return "";
+    return current->slots[node->slot];
+}
+
+void Interpreter::declareVariable(Parser::ASTNode *node, const Value &value) {
+    assert(node->depth == 0);
+    frame->slots[node->slot] = value;
+}
+
+void Interpreter::setVariableValue(Parser::ASTNode *node, const Value &value) {
+    variable(node) = value;
+}
+
+Value Interpreter::getVariableValue(Parser::ASTNode *node) {
+    Value &value = variable(node);
+    if (value.isUndefined()) log("use undefined variable: ", node->text);
+    return value;
 }
 
-Parser::ASTNode *Interpreter::getFunction(const std::string &name) {
-    map<string, Parser::ASTNode *>::iterator iter;
-    iter = functionTable.find(name);
+Parser::ASTNode *Interpreter::getFunction(Parser::ASTNode *call) {
+    auto iter = functionTable.find(call->atom);
     if (iter != functionTable.end()) {
         return iter->second;
     } else {
-        log("use undefined function: ", name);
+        log("use undefined function: ", call->text);
     }
     return nullptr;
 }
 
 string Interpreter::input() {
     string input;
-    getline(cin, input);
+    IO::readLine(input);
     return input;
 }
 
-void Interpreter::output(const string &value) {
-    cout << value << " ";
+void Interpreter::output(const Value &value) {
+    IO::write(value.toString());
+    IO::write(" ");
 }
 
-string Interpreter::visitNode(Parser::ASTNode *node) {
+Value Interpreter::visitNode(Parser::ASTNode *node) {
     if (node == nullptr) {
         log("visitNode: given node is nullptr");
-        return "";
+        return Value();
     }
     switch (node->type) {
         case Parser::VAR_DECLARE_NODE:
@@ -188,13 +327,13 @@ string Interpreter::visitNode(Parser::ASTNode *node) {
         case Parser::STRING_NODE:
         case Parser::CHAR_NODE:
         case Parser::BOOL_NODE:
-            return node->token.value;
+            return node->value;
         case Parser::VAR_NODE:
-            return getVariableValue(node->token.value);
+            return getVariableValue(node);
         case Parser::BINARY_OPERATOR_NODE:
             return visitBinaryOperatorNode(node);
         case Parser::NONE:
-            return "";
+            return Value();
         case Parser::NEGATIVE_NODE:
             return visitNegativeNode(node);
         case Parser::IF_NODE:
@@ -209,277 +348,552 @@ string Interpreter::visitNode(Parser::ASTNode *node) {
             return visitFunctionCallNode(node);
         case Parser::RETURN_NODE:
             return visitReturnNode(node);
+        case Parser::BREAK_NODE:
+            completion = BREAK;
+            return Value();
+        case Parser::CONTINUE_NODE:
+            completion = CONTINUE;
+            return Value();
         case Parser::ARRAY_ACCESS_NODE:
             return visitArrayAccessNode(node);
         case Parser::ARRAY_DECLARE_NODE:
             return visitArrayDeclareNode(node);
         default:
             error("unexpected node type: ", to_string(node->type));
-            return "";
+            return Value();
     }
 }
 
-string Interpreter::visitDeclareNode(Parser::ASTNode *node) {
+// Statements run one after another until one of them completes abruptly. The value of
+// a list is the value of its first statement, which the REPL prints.
+Value Interpreter::visitStatementList(Parser::ASTNode *node) {
+    Value result;
+    for (Parser::ASTNode *statement = node; statement != nullptr && completion == NORMAL; statement = statement->next) {
+        if (profiler != nullptr) profiler->setRow(statement->rowNumber);
+        if (statement == node) {
+            result = visitNode(statement);
+        } else {
+            visitNode(statement);
+        }
+    }
+    return result;
+}
+
+// Called after each run of a loop body: a continue only ends the iteration, a break ends
+// the loop and a return ends it too but is left for the enclosing call to consume.
+bool Interpreter::endIteration() {
+    switch (completion) {
+        case NORMAL:
+            return true;
+        case CONTINUE:
+            completion = NORMAL;
+            return true;
+        case BREAK:
+            completion = NORMAL;
+            return false;
+        default:
+            return false;
+    }
+}
+
+Value Interpreter::visitDeclareNode(Parser::ASTNode *node) {
     assert(node->type == Parser::VAR_DECLARE_NODE);
-    string varName = node->token.value;
-    Variable var;
-    var.type = node->token.type;
-    var.value = visitNode(node->child[0]);
-    declareVariable(varName, var);
-    visitNode(node->next);
-    return var.value;
+    Value value = visitNode(node->child[0]);
+    declareVariable(node, value);
+    return value;
 }
 
-string Interpreter::visitAssignNode(Parser::ASTNode *node) {
+Value Interpreter::visitAssignNode(Parser::ASTNode *node) {
     assert(node->type == Parser::VAR_ASSIGN_NODE);
-    int index = -1;
-    if (node->child[1] != nullptr) {
-        string temp = visitNode(node->child[1]);
-        try {
-            index = stoi(temp);
-        } catch (std::invalid_argument &e) {
-            index = 0;
+    bool isElement = node->child[1] != nullptr;
+    Value array; // Fetched first, like reads: the index and the value may assign the variable.
+    if (isElement) array = getArray(node);
+    bool isStored = true; // Like reads, negative and non-numeric indexes select no element.
+    size_t index = 0;
+    Value position;
+    if (isElement) {
+        position = visitNode(node->child[1]);
+        if (position.getType() == Value::INT) {
+            isStored = position.getInt() >= 0;
+            index = (size_t) position.getInt();
+        } else {
+            double real = position.toReal();
+            isStored = real >= 0 && real != INFINITY;
+            index = isStored && real < Array::MAX_SIZE ? (size_t) real : Array::MAX_SIZE;
         }
     }
-    string varName = node->token.value;
-    Variable var;
-    var.type = node->token.type;
-    var.value = visitNode(node->child[0]);
-    if (index == -1) {
-        setVariableValue(varName, var);
-    } else { // This variable is an array.
-        vector<string> *v = getArray(varName);
-        (*v)[index] = var.value;
+    Value value = visitNode(node->child[0]);
+    if (!isElement) {
+        setVariableValue(node, value);
+    } else if (isStored) { // This variable is an array, writing past the end grows it.
+        if (index >= Array::MAX_SIZE) error("array index too large: ", position.toString());
+        vector<Value> &elements = array.getArray()->mutableElements();
+        if (index >= elements.size()) elements.resize(index + 1);
+        elements[index] = value;
     }
-    visitNode(node->next);
-    return var.value;
+    return value;
 }
 
-string Interpreter::visitExpressionNode(Parser::ASTNode *node) {
+Value Interpreter::visitExpressionNode(Parser::ASTNode *node) {
     assert(node->type == Parser::EXPRESSION_NODE);
     return visitNode(node->child[0]);
 }
 
 
-string Interpreter::visitNegativeNode(Parser::ASTNode *node) {
-    string result = visitNode(node->child[0]);
-    if (!result.empty() && result[0] == '-') {
-        result = result.substr(1, result.size() - 1);
-    } else {
-        result = string("-") + result;
-    }
-    return result;
+Value Interpreter::visitNegativeNode(Parser::ASTNode *node) {
+    return Value::negate(visitNode(node->child[0]));
 }
 
-string Interpreter::visitIfNode(Parser::ASTNode *node) {
+Value Interpreter::visitIfNode(Parser::ASTNode *node) {
     assert(node->type == Parser::IF_NODE);
-    string result;
-    string condition = visitNode(node->child[0]);
-    if (condition != "0" && condition != "false" && !condition.empty()) {
-        result = visitNode(node->child[1]);
+    Value result;
+    bool condition = visitNode(node->child[0]).toBool();
+    if (jit != nullptr && jit->isRecording()) jit->recordBranch(node, condition);
+    if (condition) {
+        result = visitStatementList(node->child[1]);
     } else {
         if (node->child[2] != nullptr) {
-            result = visitNode(node->child[2]);
+            result = visitStatementList(node->child[2]);
         }
     }
-    visitNode(node->next);
     return result;
 }
 
-string Interpreter::visitBinaryOperatorNode(Parser::ASTNode *node) {
-    string opt = node->token.value;
-    string left = visitNode(node->child[0]);
-    string right = visitNode(node->child[1]);
-    string result;
-    bool leftIsString = node->child[0]->type == Parser::STRING_NODE;
-    double lv, rv;
-    try {
-        lv = stod(left);
-    } catch (std::invalid_argument &e) {
-        if (left == "false") lv = 0;
-        else lv = 1;
-        leftIsString = true;
-    }
-    try {
-        rv = stod(right);
-    } catch (std::invalid_argument &e) {
-        if (right == "false") rv = 0;
-        else rv = 1;
-    }
-    if (opt == "+") {
-        if (leftIsString) {
-            result = left + right;
-        } else {
-            result = to_string(lv + rv);
-        }
-    } else if (opt == "-") {
-        result = to_string(lv - rv);
-    } else if (opt == "*") {
-        result = to_string(lv * rv);
-    } else if (opt == "/") {
-        result = to_string(lv / rv);
-    } else if (opt == "%") {
-        int li = (int) lv;
-        int ri = (int) rv;
-        result = to_string(li % ri);
-    } else if (opt == "<=") {
-        result = lv <= rv ? "true" : "false";
-    } else if (opt == ">=") {
-        result = lv >= rv ? "true" : "false";
-    } else if (opt == "==") {
-        result = lv == rv ? "true" : "false";
-    } else if (opt == "<") {
-        result = lv < rv ? "true" : "false";
-    } else if (opt == ">") {
-        result = lv > rv ? "true" : "false";
-    } else if (opt == "!=") {
-        result = lv != rv ? "true" : "false";
-    } else if (opt == "&&") {
-        result = (lv == 0 || rv == 0) ? "false" : "true";
-    } else if (opt == "||") {
-        result = (lv != 0 || rv != 0) ? "true" : "false";
+// Operators specialize on the types of their first operands and check them on every
+// evaluation. A node whose guard fails specializes again for the new types, up to
+// MAX_DESPECIALIZATIONS times, then stays generic.
+Value Interpreter::visitBinaryOperatorNode(Parser::ASTNode *node) {
+    if (node->op == Parser::OP_AND || node->op == Parser::OP_OR) {
+        // The right operand only runs if the left one does not decide the result.
+        bool left = visitNode(node->child[0]).toBool();
+        if (left == (node->op == Parser::OP_OR)) return Value::boolean(left);
+        return Value::boolean(visitNode(node->child[1]).toBool());
+    }
+    Value left = visitNode(node->child[0]);
+    Value right = visitNode(node->child[1]);
+    if (node->op == Parser::OP_DIV && jit != nullptr && jit->isRecording()) {
+        // Whether a division is exact decides its type, the JIT compiles the one seen.
+        Value quotient = applyOperator(node->op, left, right);
+        jit->recordQuotient(node, quotient);
+        return quotient;
+    }
+    switch (node->specialization) {
+        case Parser::INT_INT:
+            if (left.getType() == Value::INT && right.getType() == Value::INT) {
+                return integerOperator(node->op, left.getInt(), right.getInt());
+            }
+            break;
+        case Parser::REAL_REAL:
+            if (left.getType() == Value::REAL && right.getType() == Value::REAL) {
+                return numberOperator(node->op, left.getReal(), right.getReal());
+            }
+            break;
+        case Parser::NUMBER_NUMBER:
+            if (left.getType() == Value::INT && right.getType() == Value::INT) {
+                return integerOperator(node->op, left.getInt(), right.getInt());
+            }
+            if (left.isNumber() && right.isNumber()) {
+                return numberOperator(node->op, left.getType() == Value::INT ? (double) left.getInt() : left.getReal(),
+                                      right.getType() == Value::INT ? (double) right.getInt() : right.getReal());
+            }
+            break;
+        case Parser::STRING_STRING:
+            if (left.isString() && right.isString()) {
+                return stringOperator(node->op, left.getString(), right.getString());
+            }
+            break;
+        case Parser::GENERIC:
+            return applyOperator(node->op, left, right);
+        default:
+            break;
+    }
+    specializeOperator(node, left, right);
+    return applyOperator(node->op, left, right);
+}
+
+void Interpreter::specializeOperator(Parser::ASTNode *node, const Value &left, const Value &right) {
+    if (node->op == Parser::OP_NONE) error("unexpected operator: ", node->text);
+    if (node->specialization != Parser::UNSPECIALIZED && ++node->despecializations > MAX_DESPECIALIZATIONS) {
+        log("despecialize operator: ", node->text);
+        node->specialization = Parser::GENERIC;
+    } else if (left.getType() == Value::INT && right.getType() == Value::INT) {
+        node->specialization = Parser::INT_INT;
+    } else if (left.getType() == Value::REAL && right.getType() == Value::REAL) {
+        node->specialization = Parser::REAL_REAL;
+    } else if (left.isNumber() && right.isNumber()) {
+        node->specialization = Parser::NUMBER_NUMBER;
+    } else if (left.isString() && right.isString() && (node->op == Parser::OP_ADD || node->op >= Parser::OP_LT)) {
+        node->specialization = Parser::STRING_STRING;
     } else {
-        error("unexpected operator: ", opt);
+        node->specialization = Parser::GENERIC;
     }
-    return result;
 }
 
-string Interpreter::visitWhileNode(Parser::ASTNode *node) {
-    enterScope();
+// What applyOperator computes for two integers.
+Value Interpreter::integerOperator(Parser::Operator op, int64_t left, int64_t right) {
+    switch (op) {
+        case Parser::OP_ADD:
+            return Value::addIntegers(left, right);
+        case Parser::OP_SUB:
+            return Value::subtractIntegers(left, right);
+        case Parser::OP_MUL:
+            return Value::multiplyIntegers(left, right);
+        case Parser::OP_DIV:
+            return Value::divideIntegers(left, right);
+        case Parser::OP_MOD:
+            return Value::moduloIntegers(left, right);
+        case Parser::OP_EQ:
+            return Value::boolean(left == right);
+        case Parser::OP_NE:
+            return Value::boolean(left != right);
+        case Parser::OP_LT:
+            return Value::boolean(left < right);
+        case Parser::OP_LE:
+            return Value::boolean(left <= right);
+        case Parser::OP_GT:
+            return Value::boolean(right < left);
+        case Parser::OP_GE:
+            return Value::boolean(right <= left);
+        default:
+            return Value();
+    }
+}
+
+// What applyOperator computes for two numbers, not both integers: it combines them as reals.
+Value Interpreter::numberOperator(Parser::Operator op, double left, double right) {
+    switch (op) {
+        case Parser::OP_ADD:
+            return Value::real(left + right);
+        case Parser::OP_SUB:
+            return Value::real(left - right);
+        case Parser::OP_MUL:
+            return Value::real(left * right);
+        case Parser::OP_DIV:
+            return Value::real(left / right);
+        case Parser::OP_MOD:
+            return Value::real(fmod(left, right));
+        case Parser::OP_EQ:
+            return Value::boolean(left == right);
+        case Parser::OP_NE:
+            return Value::boolean(left != right);
+        case Parser::OP_LT:
+            return Value::boolean(left < right);
+        case Parser::OP_LE:
+            return Value::boolean(left <= right);
+        case Parser::OP_GT:
+            return Value::boolean(right < left);
+        case Parser::OP_GE:
+            return Value::boolean(right <= left);
+        default:
+            return Value();
+    }
+}
+
+Value Interpreter::stringOperator(Parser::Operator op, const std::string &left, const std::string &right) {
+    switch (op) {
+        case Parser::OP_ADD:
+            return Value::string(left + right);
+        case Parser::OP_EQ:
+            return Value::boolean(left == right);
+        case Parser::OP_NE:
+            return Value::boolean(left != right);
+        case Parser::OP_LT:
+            return Value::boolean(left < right);
+        case Parser::OP_LE:
+            return Value::boolean(left <= right);
+        case Parser::OP_GT:
+            return Value::boolean(right < left);
+        case Parser::OP_GE:
+            return Value::boolean(right <= left);
+        default:
+            return Value();
+    }
+}
+
+// Shared with the optimizer, so folded constants are exactly what the walker computes.
+Value Interpreter::applyOperator(Parser::Operator op, const Value &left, const Value &right) {
+    switch (op) {
+        case Parser::OP_ADD:
+            return Value::add(left, right);
+        case Parser::OP_SUB:
+            return Value::subtract(left, right);
+        case Parser::OP_MUL:
+            return Value::multiply(left, right);
+        case Parser::OP_DIV:
+            return Value::divide(left, right);
+        case Parser::OP_MOD:
+            return Value::modulo(left, right);
+        case Parser::OP_EQ:
+            return Value::boolean(Value::equals(left, right));
+        case Parser::OP_NE:
+            return Value::boolean(!Value::equals(left, right));
+        case Parser::OP_LT:
+            return Value::boolean(Value::less(left, right));
+        case Parser::OP_LE:
+            return Value::boolean(Value::lessEqual(left, right));
+        case Parser::OP_GT:
+            return Value::boolean(Value::less(right, left));
+        case Parser::OP_GE:
+            return Value::boolean(Value::lessEqual(right, left));
+        case Parser::OP_AND:
+            return Value::boolean(left.toBool() && right.toBool());
+        case Parser::OP_OR:
+            return Value::boolean(left.toBool() || right.toBool());
+        default:
+            return Value();
+    }
+}
+
+// Loop scopes that declare nothing have size 0: the resolver elided them, so no frame is pushed.
+Value Interpreter::visitWhileNode(Parser::ASTNode *node) {
     assert(node->type == Parser::WHILE_NODE);
-    string condition = visitNode(node->child[0]);
-    while (condition != "0" && condition != "false" && !condition.empty()) {
-        enterScope();
-        visitNode(node->child[1]);
-        condition = visitNode(node->child[0]);
-        exitScope();
+    Frame *outer = node->scopeSize > 0 ? enterScope(node->scopeSize, frame) : nullptr;
+    while (true) {
+        bool finished = false;
+        if (jit != nullptr && runCompiledLoop(node, nullptr, finished)) {
+            if (finished) break;
+            continue;
+        }
+        if (!visitNode(node->child[0]).toBool()) break;
+        if (node->bodyScopeSize > 0) {
+            Frame *header = enterScope(node->bodyScopeSize, frame);
+            visitStatementList(node->child[1]);
+            exitScope(header);
+        } else {
+            visitStatementList(node->child[1]);
+        }
+        if (!endIteration()) break;
     }
-    exitScope();
-    visitNode(node->next);
-    return "";
+    if (jit != nullptr) jit->loopFinished(node);
+    if (outer != nullptr) exitScope(outer);
+    return Value();
 }
 
-string Interpreter::visitForNode(Parser::ASTNode *node) {
-    enterScope();
+Value Interpreter::visitForNode(Parser::ASTNode *node) {
     assert(node->type == Parser::FOR_NODE);
+    Frame *outer = node->scopeSize > 0 ? enterScope(node->scopeSize, frame) : nullptr;
     visitNode(node->child[0]); // Initialization
-    string condition = visitNode(node->child[1]); // Condition
-    while (condition != "0" && condition != "false" && !condition.empty()) {
-        enterScope();
-        visitNode(node->child[3]); // Body
+    while (true) {
+        bool finished = false;
+        if (jit != nullptr && runCompiledLoop(node, node->child[2], finished)) {
+            if (finished) break;
+            continue;
+        }
+        if (!visitNode(node->child[1]).toBool()) break; // Condition
+        if (node->bodyScopeSize > 0) {
+            Frame *header = enterScope(node->bodyScopeSize, frame);
+            visitStatementList(node->child[3]); // Body
+            exitScope(header);
+        } else {
+            visitStatementList(node->child[3]); // Body
+        }
+        if (!endIteration()) break;
         visitNode(node->child[2]); // Update
-        exitScope();
-        condition = visitNode(node->child[1]); // Check condition
     }
-    exitScope();
-    visitNode(node->next);
-    return "";
+    if (jit != nullptr) jit->loopFinished(node);
+    if (outer != nullptr) exitScope(outer);
+    return Value();
+}
+
+// Run the loop's native code from the head of an iteration, if it has any, and finish the
+// iteration it left in. Returns false if the walker has to run the whole iteration.
+// Compiled loops declare nothing in their body, so no body scope is entered.
+bool Interpreter::runCompiledLoop(Parser::ASTNode *node, Parser::ASTNode *update, bool &finished) {
+    const Jit::Exit *exit = jit->iteration(node, frame);
+    if (exit == nullptr) return false;
+    switch (exit->kind) {
+        case Jit::Exit::LOOP_END:
+            finished = true;
+            return true;
+        case Jit::Exit::RESUME_CONDITION:
+            return false;
+        case Jit::Exit::RESUME_BODY:
+            for (size_t i = 0; i < exit->resume.size() && completion == NORMAL; ++i) {
+                visitStatementList(exit->resume[i]);
+            }
+            if (!endIteration()) {
+                finished = true;
+                return true;
+            }
+            break;
+        default:
+            break;
+    }
+    if (update != nullptr) visitNode(update);
+    return true;
 }
 
-string Interpreter::visitFunctionDeclareNode(Parser::ASTNode *node) {
+Value Interpreter::visitFunctionDeclareNode(Parser::ASTNode *node) {
     assert(node->type == Parser::FUNCTION_DECLARE_NODE);
-    string name = node->token.value;
-    map<string, Parser::ASTNode *>::iterator iter;
-    iter = functionTable.find(name);
+    auto iter = functionTable.find(node->atom);
     if (iter == functionTable.end()) {
-        functionTable.insert({name, node});
+        functionTable.insert({node->atom, node});
+        functionTableVersion++;
     } else {
-        log("define a function multiple times: ", name);
+        log("define a function multiple times: ", node->text);
     }
-    visitNode(node->next);
-    return "";
+    return Value();
 }
 
-string Interpreter::visitFunctionCallNode(Parser::ASTNode *node) {
-    enterScope();
-    string result;
-    string functionName = node->token.value;
+Value Interpreter::visitFunctionCallNode(Parser::ASTNode *node) {
+    Value result;
     Parser::ASTNode *parameterNode = node->child[0];
-    if (functionName == "input") {
-        result = input();
-    } else if (functionName == "output") {
-        string outputValue = visitNode(parameterNode);
+    if (node->atom == AtomTable::INPUT) {
+        result = Value::string(input());
+    } else if (node->atom == AtomTable::OUTPUT) {
+        Value outputValue = visitNode(parameterNode);
         output(outputValue);
     } else {
-        // First we should initialize the parameters with arguments.
-        // Notice there are something special if the arguments are array, we should do
-        // an extra job: copy the array.
-        Parser::ASTNode *functionNode = getFunction(functionName);
-        Parser::ASTNode *argumentNode = functionNode->child[0];
-        while (argumentNode != nullptr && parameterNode != nullptr) {
-            Variable var;
-            var.type = argumentNode->token.type;
-            var.value = visitNode(parameterNode);
-            if (var.value.rfind("__array_", 0) == 0) {
-                // This is an array.
-                var.value = copyArray(var.value);
+        Parser::ASTNode *functionNode = getCallee(node);
+        Frame *callee = newCallFrame(node, functionNode);
+        bool memoizable = functionNode->memo >= 0;
+        int parameters = 0; // Parameters take the first slots of the frame.
+        if (memoizable) {
+            for (auto *argumentNode = functionNode->child[0]; argumentNode != nullptr; argumentNode = argumentNode->next) {
+                if (argumentNode->slot >= parameters) parameters = argumentNode->slot + 1;
+            }
+            for (int i = 0; i < parameters; ++i) {
+                if (callee->slots[i].isArray()) memoizable = false;
             }
-            declareVariable(argumentNode->token.value, var);
-            argumentNode = argumentNode->next;
-            parameterNode = parameterNode->next;
         }
-        // The we execute this function's body.
-        visitNode(functionNode->child[1]);
-        result = returnValue;
-        returnValue = "notice this return value has been used, check your code";
+        if (memoizable && memoTables[functionNode->memo].find(callee->slots.data(), parameters, result)) {
+            freeFrame(callee);
+        } else {
+            // The body may assign its parameters, so the key is kept aside.
+            vector<Value> key;
+            if (memoizable) key.assign(callee->slots.begin(), callee->slots.begin() + parameters);
+            // The we execute this function's body.
+            Frame *caller = frame;
+            frame = callee;
+            if (profiler != nullptr) {
+                profiler->setRow(node->rowNumber);
+                profiler->enter(functionNode->text, functionNode->rowNumber);
+            }
+            visitStatementList(functionNode->child[1]);
+            // A tail call leaves its callee and frame behind instead of recursing, it runs here.
+            while (tailCallee != nullptr) {
+                Parser::ASTNode *next = tailCallee;
+                tailCallee = nullptr;
+                freeFrame(frame);
+                frame = tailFrame;
+                returnValue = Value();
+                completion = NORMAL;
+                if (profiler != nullptr) profiler->replace(next->text, next->rowNumber);
+                visitStatementList(next->child[1]);
+            }
+            if (profiler != nullptr) profiler->leave();
+            completion = NORMAL;
+            if (memoizable && !returnValue.isArray()) {
+                memoTables[functionNode->memo].insert(key.data(), parameters, returnValue);
+            }
+            exitScope(caller);
+            result = returnValue;
+            returnValue = Value();
+        }
     }
-    exitScope();
-    visitNode(node->next);
     return result;
 }
 
-string Interpreter::visitReturnNode(Parser::ASTNode *node) {
+// Each call site caches its target until the function table changes.
+Parser::ASTNode *Interpreter::getCallee(Parser::ASTNode *call) {
+    if (call->calleeVersion != functionTableVersion) {
+        call->callee = getFunction(call);
+        call->calleeVersion = functionTableVersion;
+    }
+    if (call->callee == nullptr) error("call undefined function: ", call->text);
+    return call->callee;
+}
+
+// Arguments are evaluated in the caller's frame, the callee's frame is linked to the globals.
+// Arrays are passed by value, so they are copied.
+Interpreter::Frame *Interpreter::newCallFrame(Parser::ASTNode *call, Parser::ASTNode *function) {
+    Frame *callee = newFrame(function->scopeSize, globals);
+    Parser::ASTNode *parameterNode = call->child[0];
+    Parser::ASTNode *argumentNode = function->child[0];
+    while (argumentNode != nullptr && parameterNode != nullptr) {
+        Value value = visitNode(parameterNode);
+        if (value.isArray()) value = copyArray(value);
+        callee->slots[argumentNode->slot] = value;
+        argumentNode = argumentNode->next;
+        parameterNode = parameterNode->next;
+    }
+    return callee;
+}
+
+Value Interpreter::visitReturnNode(Parser::ASTNode *node) {
     assert(node->type == Parser::RETURN_NODE);
+    if (node->isTailCall) {
+        Parser::ASTNode *call = node->child[0]->type == Parser::EXPRESSION_NODE ? node->child[0]->child[0] : node->child[0];
+        Parser::ASTNode *functionNode = getCallee(call);
+        tailFrame = newCallFrame(call, functionNode);
+        tailCallee = functionNode;
+        completion = RETURN;
+        return Value();
+    }
     returnValue = visitNode(node->child[0]);
+    completion = RETURN;
     return returnValue;
 }
 
-string Interpreter::visitArrayDeclareNode(Parser::ASTNode *node) {
+Value Interpreter::visitArrayDeclareNode(Parser::ASTNode *node) {
     assert(node->type == Parser::ARRAY_DECLARE_NODE);
-    string identifier("__array_" + to_string(arrayTable.size()));
-    auto *store = new vector<string>;
+    vector<Value> elements;
     auto *current = node->child[0];
     while (current != nullptr) {
-        store->push_back(visitNode(current));
+        elements.push_back(visitNode(current));
         current = current->next;
     }
-    arrayTable.insert({identifier, store});
-    return identifier;
+    return Collector::newArray(std::move(elements));
 }
 
-
-string Interpreter::copyArray(const std::string &identifier) {
-    auto *origin = getArray(identifier, true);
-    auto *copy = new vector<string>(*origin);
-    string newIdentifier("__array_" + to_string(arrayTable.size()));
-    arrayTable.insert({newIdentifier, copy});
-    return newIdentifier;
+// Arrays are passed to functions by value. The copy shares the elements until either
+// side writes, so passing an array costs nothing for callees that only read it.
+Value Interpreter::copyArray(const Value &array) {
+    return Collector::newArray(array.getArray());
 }
 
-string Interpreter::visitArrayAccessNode(Parser::ASTNode *node) {
+// Elements past the end read as undefined. The node specializes on the type of its index
+// like an operator on the types of its operands.
+Value Interpreter::visitArrayAccessNode(Parser::ASTNode *node) {
     assert(node->type == Parser::ARRAY_ACCESS_NODE);
-    string arrayName = node->token.value;
-    vector<string> *v = getArray(arrayName);
-    string index = visitNode(node->child[0]);
-    int i = 0;
-    try {
-        i = stoi(index);
-    } catch (std::invalid_argument &e) {
-        i = 0;
-    }
-    return (*v)[i];
-}
-
-std::vector<string> *Interpreter::getArray(const std::string &name, bool isIdentifier) {
-    string identifier = isIdentifier ? name : getVariableValue(name);
-    assert(identifier[0] == '_');
-    map<std::string, vector<string> *>::iterator iter;
-    iter = arrayTable.find(identifier);
-    if (iter != arrayTable.end()) {
-        return iter->second;
+    Value array = getArray(node); // Held while the index runs, which may assign the variable.
+    Value index = visitNode(node->child[0]);
+    const vector<Value> &elements = array.getArray()->elements();
+    size_t position = elements.size(); // Past the end unless the index selects an element.
+    if (node->specialization == Parser::INT_INDEX && index.getType() == Value::INT) {
+        if (index.getInt() >= 0 && (uint64_t) index.getInt() < elements.size()) position = (size_t) index.getInt();
+    } else {
+        double real;
+        if (node->specialization == Parser::REAL_INDEX && index.getType() == Value::REAL) {
+            real = index.getReal();
+        } else {
+            if (node->specialization != Parser::GENERIC) specializeAccess(node, index);
+            real = index.toReal();
+        }
+        if (real >= 0 && real < elements.size()) position = (size_t) real;
     }
-    log("use of undefined array: ", name);
-    return nullptr;
+    Value element = position < elements.size() ? elements[position] : Value();
+    if (jit != nullptr && jit->isRecording()) jit->recordElement(node, element);
+    return element;
+}
+
+void Interpreter::specializeAccess(Parser::ASTNode *node, const Value &index) {
+    if (node->specialization != Parser::UNSPECIALIZED && ++node->despecializations > MAX_DESPECIALIZATIONS) {
+        log("despecialize array access: ", node->text);
+        node->specialization = Parser::GENERIC;
+    } else if (index.getType() == Value::INT) {
+        node->specialization = Parser::INT_INDEX;
+    } else if (index.getType() == Value::REAL) {
+        node->specialization = Parser::REAL_INDEX;
+    } else {
+        node->specialization = Parser::GENERIC;
+    }
+}
+
+Value Interpreter::getArray(Parser::ASTNode *node) {
+    const Value &array = variable(node);
+    if (!array.isArray()) error("not an array: ", node->text);
+    return array;
 }
 
 
@@ -0,0 +1,784 @@
+#include "Jit.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+
+using namespace std;
+
+typedef Assembler A;
+
+static const int RECORD_ITERATIONS = 16;
+static const int MAX_COMPILATIONS = 8; // Per loop: one trace per set of entry types, and retraces.
+static const size_t MAX_CODE_SIZE = 256 * 1024;
+
+const int32_t Jit::TYPE_OFFSET = offsetof(Value, type);
+const int32_t Jit::PAYLOAD_OFFSET = offsetof(Value, as);
+
+static_assert(sizeof(Value) == 16, "element addresses are computed with a shift by 4");
+
+Jit::Jit(int threshold) : threshold(threshold) {}
+
+Jit::~Jit() {
+    for (Loop &loop : loops) release(loop);
+}
+
+void Jit::setDebugMode(bool enable) {
+    debug = enable;
+}
+
+void Jit::log(const string &message, const std::string &extra) {
+    if (!debug) return;
+    cout << "[Jit] [Log]: " << message << extra << endl;
+}
+
+void Jit::report() const {
+    cout << "[Jit] loops compiled: " << compiled
+         << ", further traces: " << recompiled
+         << ", aborted: " << aborted
+         << ", entries: " << entries
+         << ", refused on types: " << guardMisses
+         << ", exits: " << exits[Exit::LOOP_END] << " at loop end, "
+         << exits[Exit::RESUME_CONDITION] << " to the condition, "
+         << exits[Exit::RESUME_BODY] << " to the body, "
+         << exits[Exit::RESUME_UPDATE] << " to the update" << endl;
+}
+
+Jit::Loop &Jit::getLoop(Parser::ASTNode *node) {
+    if (node->jitLoop < 0) {
+        node->jitLoop = (int) loops.size();
+        loops.emplace_back();
+        loops.back().node = node;
+    }
+    return loops[node->jitLoop];
+}
+
+Parser::ASTNode *Jit::condition(Parser::ASTNode *loop) {
+    return loop->type == Parser::WHILE_NODE ? loop->child[0] : loop->child[1];
+}
+
+Parser::ASTNode *Jit::body(Parser::ASTNode *loop) {
+    return loop->type == Parser::WHILE_NODE ? loop->child[1] : loop->child[3];
+}
+
+Parser::ASTNode *Jit::update(Parser::ASTNode *loop) {
+    return loop->type == Parser::WHILE_NODE ? nullptr : loop->child[2];
+}
+
+Value &Jit::resolve(Interpreter::Frame *frame, int depth, int slot) {
+    for (int i = depth; i > 0; --i) {
+        frame = frame->parent;
+    }
+    return frame->slots[slot];
+}
+
+const Jit::Exit *Jit::iteration(Parser::ASTNode *node, Interpreter::Frame *frame) {
+    Loop &loop = getLoop(node);
+    switch (loop.state) {
+        case COUNTING:
+            if (++loop.iterations >= threshold && recording < 0) {
+                loop.state = RECORDING;
+                recording = node->jitLoop;
+            }
+            return nullptr;
+        case RECORDING:
+            if (recording != node->jitLoop) { // Finished in between, the recorder may be taken.
+                if (recording >= 0) {
+                    loop.state = COUNTING;
+                    return nullptr;
+                }
+                recording = node->jitLoop;
+            }
+            if (++loop.iterations <= threshold + RECORD_ITERATIONS) return nullptr;
+            recording = -1;
+            loop.state = COMPILED;
+            return run(loop, frame);
+        case COMPILED:
+            if (!loop.retrace) return run(loop, frame);
+            release(loop);
+            loop.retrace = false;
+            loop.state = COUNTING;
+            loop.iterations = threshold - 1; // Record as soon as the recorder is free.
+            return nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+void Jit::loopFinished(Parser::ASTNode *node) {
+    if (recording >= 0 && recording == node->jitLoop) recording = -1;
+}
+
+void Jit::recordBranch(Parser::ASTNode *node, bool taken) {
+    loops[recording].branches[node] |= taken ? 2 : 1;
+}
+
+void Jit::recordElement(Parser::ASTNode *node, const Value &element) {
+    loops[recording].elements[node] |= 1 << element.getType();
+}
+
+void Jit::recordQuotient(Parser::ASTNode *node, const Value &quotient) {
+    loops[recording].quotients[node] |= 1 << quotient.getType();
+}
+
+void Jit::release(Loop &loop) {
+    for (Trace *trace : loop.traces) {
+        munmap((void *) trace->code, trace->codeSize);
+        delete trace;
+    }
+    loop.traces.clear();
+}
+
+// Run the first trace compiled for the types the variables have now, compiling one if
+// there is none yet.
+const Jit::Exit *Jit::run(Loop &loop, Interpreter::Frame *frame) {
+    for (Trace *trace : loop.traces) {
+        if (enter(*trace, frame)) return execute(loop, *trace);
+    }
+    if (loop.compilations < MAX_COMPILATIONS) {
+        Trace *trace = compile(loop, frame);
+        if (trace == nullptr) return nullptr;
+        if (enter(*trace, frame)) return execute(loop, *trace);
+    }
+    guardMisses++;
+    return nullptr;
+}
+
+// Check the variables against the types the trace was compiled for and fill in its slots.
+// Arrays whose elements are assigned are unshared first, the walker would do it on the
+// first write, so the read-only ones see the buffer they end up with.
+bool Jit::enter(Trace &trace, Interpreter::Frame *frame) {
+    for (size_t i = 0; i < trace.variables.size(); ++i) {
+        const Variable &variable = trace.variables[i];
+        const Value &value = resolve(frame, variable.depth, variable.slot);
+        if (value.getType() != variable.type) return false;
+    }
+    for (size_t i = 0; i < trace.variables.size(); ++i) {
+        const Variable &variable = trace.variables[i];
+        Value &value = resolve(frame, variable.depth, variable.slot);
+        trace.slots[i].value = &value;
+        if (variable.isWritten) {
+            vector<Value> &elements = value.getArray()->mutableElements();
+            trace.slots[i].elements = elements.data();
+            trace.slots[i].size = (int64_t) elements.size();
+        }
+    }
+    for (size_t i = 0; i < trace.variables.size(); ++i) {
+        if (!trace.variables[i].isArray || trace.variables[i].isWritten) continue;
+        const vector<Value> &elements = trace.slots[i].value->getArray()->elements();
+        trace.slots[i].elements = const_cast<Value *>(elements.data());
+        trace.slots[i].size = (int64_t) elements.size();
+    }
+    return true;
+}
+
+const Jit::Exit *Jit::execute(Loop &loop, Trace &trace) {
+    entries++;
+    Exit &exit = trace.exits[trace.code(trace.slots.data())];
+    exit.taken++;
+    exits[exit.kind]++;
+    if (exit.isGuess && exit.taken >= (unsigned) threshold && loop.compilations < MAX_COMPILATIONS) {
+        loop.retrace = true;
+    }
+    return &exit;
+}
+
+// Native code layout: rbx points to the slots, rbp to the frame of the trace, so a side
+// exit can drop whatever temporaries are on the stack. The exit index is returned in eax.
+Jit::Trace *Jit::compile(Loop &loop, Interpreter::Frame *frame) {
+    loop.compilations++;
+    Compiler c;
+    c.loop = &loop;
+    c.frame = frame;
+    c.trace = new Trace();
+    A &a = c.assembler;
+    if (loop.node->bodyScopeSize > 0) c.abort = "the body declares variables";
+    a.push(A::RBX);
+    a.push(A::RBP);
+    a.move(A::RBP, A::RSP);
+    a.move(A::RBX, A::RDI);
+    c.head = a.newLabel();
+    a.bind(c.head);
+    int loopEnd = newExit(c, Exit::LOOP_END, {});
+    int conditionExit = newExit(c, Exit::RESUME_CONDITION, {});
+    Types types;
+    Value::Type type;
+    if (c.abort.empty() && compileExpression(c, condition(loop.node), types, conditionExit, type)) {
+        compileTruth(c, type);
+        a.jump(A::EQUAL, c.exitLabels[loopEnd]);
+        compileStatements(c, body(loop.node), {}, types);
+    }
+    void *memory = MAP_FAILED;
+    vector<uint8_t> code;
+    if (c.abort.empty()) {
+        A::Label epilogue = a.newLabel();
+        for (size_t i = 0; i < c.exitLabels.size(); ++i) {
+            a.bind(c.exitLabels[i]);
+            a.move(A::RAX, (uint64_t) i);
+            a.jump(epilogue);
+        }
+        a.bind(epilogue);
+        a.move(A::RSP, A::RBP);
+        a.pop(A::RBP);
+        a.pop(A::RBX);
+        a.ret();
+        code = a.finish();
+        memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) c.abort = "out of executable memory";
+    }
+    if (!c.abort.empty()) {
+        log("abort loop at row " + to_string(loop.node->rowNumber) + ": ", c.abort);
+        delete c.trace;
+        // The traces compiled so far stay, but no more are tried.
+        if (loop.traces.empty()) loop.state = BLACKLISTED;
+        loop.compilations = MAX_COMPILATIONS;
+        aborted++;
+        return nullptr;
+    }
+    memcpy(memory, code.data(), code.size());
+    mprotect(memory, code.size(), PROT_READ | PROT_EXEC);
+    c.trace->code = reinterpret_cast<uint32_t (*)(Slot *)>(memory);
+    c.trace->codeSize = code.size();
+    c.trace->slots.resize(c.trace->variables.size());
+    loop.traces.push_back(c.trace);
+    if (loop.compilations > 1) recompiled++; else compiled++;
+    log("compiled loop at row " + to_string(loop.node->rowNumber) + ": ", to_string(code.size()) + " bytes, " +
+        to_string(c.trace->variables.size()) + " variables, " + to_string(c.trace->exits.size()) + " exits");
+    return c.trace;
+}
+
+int Jit::newExit(Compiler &c, Exit::Kind kind, const vector<Parser::ASTNode *> &resume) {
+    Exit exit;
+    exit.kind = kind;
+    exit.resume = resume;
+    c.trace->exits.push_back(exit);
+    c.exitLabels.push_back(c.assembler.newLabel());
+    return (int) c.trace->exits.size() - 1;
+}
+
+// A copy of exit for a guard on what the recording saw. Taken often, the loop is recorded again.
+int Jit::guessExit(Compiler &c, int exit) {
+    int guess = newExit(c, c.trace->exits[exit].kind, c.trace->exits[exit].resume);
+    c.trace->exits[guess].isGuess = true;
+    return guess;
+}
+
+int32_t Jit::slotOffset(int variable) {
+    return (int32_t) (variable * sizeof(Slot));
+}
+
+Value::Type Jit::typeOf(const Compiler &c, const Types &types, int variable) {
+    return (size_t) variable < types.size() ? types[variable] : c.trace->variables[variable].type;
+}
+
+// The trace's index of a variable, added with its current type on first use. -1 if it can't be used.
+int Jit::variable(Compiler &c, Parser::ASTNode *node, bool isArray) {
+    vector<Variable> &variables = c.trace->variables;
+    for (size_t i = 0; i < variables.size(); ++i) {
+        if (variables[i].depth != node->depth || variables[i].slot != node->slot) continue;
+        if (variables[i].isArray != isArray) {
+            c.abort = "used both as an array and as a number: " + string(node->text);
+            return -1;
+        }
+        return (int) i;
+    }
+    const Value &value = resolve(c.frame, node->depth, node->slot);
+    Value::Type type = value.getType();
+    if (isArray ? type != Value::ARRAY : type != Value::BOOL && type != Value::INT && type != Value::REAL) {
+        c.abort = "unsupported type of variable: " + string(node->text);
+        return -1;
+    }
+    variables.push_back({node->depth, node->slot, type, isArray, false});
+    return (int) variables.size() - 1;
+}
+
+// Compile the rest of an iteration: the statements from statement on, then the lists in
+// rest from the last to the first, then the update and the jump back to the head. If
+// branches both ran while recording, each gets its own copy of what follows.
+bool Jit::compileStatements(Compiler &c, Parser::ASTNode *statement, vector<Parser::ASTNode *> rest, Types types) {
+    A &a = c.assembler;
+    while (true) {
+        if (a.size() > MAX_CODE_SIZE) {
+            c.abort = "trace too large";
+            return false;
+        }
+        if (statement == nullptr) {
+            if (!rest.empty()) {
+                statement = rest.back();
+                rest.pop_back();
+                continue;
+            }
+            Parser::ASTNode *node = update(c.loop->node);
+            if (node != nullptr && node->type != Parser::NONE && node->type != Parser::VAR_ASSIGN_NODE) {
+                c.abort = "unsupported update";
+                return false;
+            }
+            if (node != nullptr && node->type == Parser::VAR_ASSIGN_NODE && !compileAssign(c, node, types, newExit(c, Exit::RESUME_UPDATE, {}))) return false;
+            for (size_t i = 0; i < types.size(); ++i) {
+                if (types[i] != c.trace->variables[i].type) {
+                    // The next iteration would need another trace, the walker runs it.
+                    a.jump(c.exitLabels[newExit(c, Exit::RESUME_CONDITION, {})]);
+                    return true;
+                }
+            }
+            a.jump(c.head);
+            return true;
+        }
+        vector<Parser::ASTNode *> resume = {statement};
+        for (auto iter = rest.rbegin(); iter != rest.rend(); ++iter) {
+            if (*iter != nullptr) resume.push_back(*iter);
+        }
+        switch (statement->type) {
+            case Parser::NONE:
+                statement = statement->next;
+                break;
+            case Parser::EXPRESSION_NODE:
+                if (!isPure(statement)) {
+                    c.abort = "call in an expression statement";
+                    return false;
+                }
+                statement = statement->next;
+                break;
+            case Parser::VAR_ASSIGN_NODE:
+                if (!compileAssign(c, statement, types, newExit(c, Exit::RESUME_BODY, resume))) return false;
+                statement = statement->next;
+                break;
+            case Parser::IF_NODE: {
+                int exit = newExit(c, Exit::RESUME_BODY, resume);
+                uint8_t seen = c.loop->branches[statement];
+                if (seen == 0) { // Not reached while recording.
+                    a.jump(c.exitLabels[guessExit(c, exit)]);
+                    return true;
+                }
+                Value::Type type;
+                if (!compileExpression(c, statement->child[0], types, exit, type)) return false;
+                compileTruth(c, type);
+                rest.push_back(statement->next);
+                if (seen == 3) {
+                    A::Label otherwise = a.newLabel();
+                    a.jump(A::EQUAL, otherwise);
+                    if (!compileStatements(c, statement->child[1], rest, types)) return false;
+                    a.bind(otherwise);
+                    statement = statement->child[2];
+                } else if (seen == 2) {
+                    a.jump(A::EQUAL, c.exitLabels[guessExit(c, exit)]);
+                    statement = statement->child[1];
+                } else {
+                    a.jump(A::NOT_EQUAL, c.exitLabels[guessExit(c, exit)]);
+                    statement = statement->child[2];
+                }
+                break;
+            }
+            case Parser::WHILE_NODE:
+            case Parser::FOR_NODE:
+                c.abort = "nested loop";
+                return false;
+            default:
+                c.abort = "unsupported statement at row " + to_string(statement->rowNumber);
+                return false;
+        }
+    }
+}
+
+// All guards run before the store, so an exit leaves the variable untouched.
+bool Jit::compileAssign(Compiler &c, Parser::ASTNode *node, Types &types, int exit) {
+    A &a = c.assembler;
+    Value::Type type;
+    if (node->child[1] == nullptr) {
+        if (!compileExpression(c, node->child[0], types, exit, type)) return false;
+        int v = variable(c, node, false);
+        if (v < 0) return false;
+        a.load(A::RCX, A::RBX, slotOffset(v) + (int32_t) offsetof(Slot, value));
+        storeValue(c, A::RCX, A::RAX, type);
+        if (types.size() <= (size_t) v) {
+            for (size_t i = types.size(); i <= (size_t) v; ++i) types.push_back(c.trace->variables[i].type);
+        }
+        types[v] = type;
+        return true;
+    }
+    int v = variable(c, node, true);
+    if (v < 0) return false;
+    c.trace->variables[v].isWritten = true;
+    if (!compileExpression(c, node->child[0], types, exit, type)) return false;
+    pushValue(c, type);
+    if (!compileAddress(c, v, node->child[1], types, exit)) return false;
+    // The element being replaced must not hold a reference.
+    a.compare32(A::RAX, TYPE_OFFSET, Value::REAL);
+    a.jump(A::ABOVE, c.exitLabels[exit]);
+    if (type == Value::REAL) {
+        popDouble(c, 0);
+    } else {
+        a.pop(A::RCX);
+        c.stackDepth--;
+    }
+    storeValue(c, A::RAX, A::RCX, type);
+    return true;
+}
+
+// Leaves the address of the element in rax. Indexes the walker would not read or write
+// in place, negative, not a number, or past the end, exit.
+bool Jit::compileAddress(Compiler &c, int v, Parser::ASTNode *index, const Types &types, int exit) {
+    A &a = c.assembler;
+    Value::Type type;
+    if (!compileExpression(c, index, types, exit, type)) return false;
+    if (type == Value::REAL) {
+        a.xorDouble(1, 1);
+        a.compareDouble(0, 1);
+        a.jump(A::BELOW, c.exitLabels[exit]);
+        a.truncateToInteger(A::RCX, 0);
+    } else {
+        a.move(A::RCX, A::RAX); // Negative integers are past the end as unsigned.
+    }
+    a.load(A::RAX, A::RBX, slotOffset(v) + (int32_t) offsetof(Slot, size));
+    a.compare(A::RCX, A::RAX);
+    a.jump(A::ABOVE_EQUAL, c.exitLabels[exit]);
+    a.load(A::RAX, A::RBX, slotOffset(v) + (int32_t) offsetof(Slot, elements));
+    a.shiftLeft(A::RCX, 4);
+    a.add(A::RAX, A::RCX);
+    return true;
+}
+
+// The element has the one numeric type recorded at this read, anything else exits.
+bool Jit::compileElement(Compiler &c, Parser::ASTNode *node, const Types &types, int exit, Value::Type &type) {
+    A &a = c.assembler;
+    int v = variable(c, node, true);
+    if (v < 0) return false;
+    uint8_t seen = c.loop->elements[node];
+    if (seen & (1 << Value::STRING | 1 << Value::ARRAY)) {
+        c.abort = "array element that is not a number: " + string(node->text);
+        return false;
+    }
+    seen &= 1 << Value::BOOL | 1 << Value::INT | 1 << Value::REAL;
+    if (seen != 1 << Value::BOOL && seen != 1 << Value::INT && seen != 1 << Value::REAL) {
+        if (seen != 0) {
+            c.abort = "array element of several types: " + string(node->text);
+            return false;
+        }
+        a.jump(c.exitLabels[guessExit(c, exit)]); // Never read a number here while recording.
+        type = Value::REAL;
+        return true;
+    }
+    type = seen == 1 << Value::BOOL ? Value::BOOL : seen == 1 << Value::INT ? Value::INT : Value::REAL;
+    if (!compileAddress(c, v, node->child[0], types, exit)) return false;
+    a.compare32(A::RAX, TYPE_OFFSET, type);
+    a.jump(A::NOT_EQUAL, c.exitLabels[guessExit(c, exit)]);
+    loadValue(c, A::RAX, type);
+    return true;
+}
+
+// Evaluate into rax if the result is an integer or a boolean (0 or 1), into xmm0 if it is a real.
+bool Jit::compileExpression(Compiler &c, Parser::ASTNode *node, const Types &types, int exit, Value::Type &type) {
+    A &a = c.assembler;
+    switch (node->type) {
+        case Parser::EXPRESSION_NODE:
+            return compileExpression(c, node->child[0], types, exit, type);
+        case Parser::INT_NODE:
+        case Parser::REAL_NODE:
+        case Parser::BOOL_NODE: {
+            type = node->value.getType();
+            if (type == Value::INT) {
+                a.move(A::RAX, (uint64_t) node->value.getInt());
+            } else if (type == Value::BOOL) {
+                a.move(A::RAX, (uint64_t) node->value.getBool());
+            } else {
+                double number = node->value.getReal();
+                uint64_t bits;
+                memcpy(&bits, &number, sizeof(bits));
+                a.move(A::RAX, bits);
+                a.moveToDouble(0, A::RAX);
+            }
+            return true;
+        }
+        case Parser::VAR_NODE: {
+            int v = variable(c, node, false);
+            if (v < 0) return false;
+            type = typeOf(c, types, v);
+            a.load(A::RAX, A::RBX, slotOffset(v) + (int32_t) offsetof(Slot, value));
+            loadValue(c, A::RAX, type);
+            return true;
+        }
+        case Parser::ARRAY_ACCESS_NODE:
+            return compileElement(c, node, types, exit, type);
+        case Parser::NEGATIVE_NODE:
+            if (!compileExpression(c, node->child[0], types, exit, type)) return false;
+            if (type == Value::INT) { // The walker negates the smallest integer as a real.
+                a.negate(A::RAX);
+                a.jump(A::OVERFLOW, c.exitLabels[exit]);
+            } else {
+                toDouble(c, type, 0);
+                a.move(A::RAX, (uint64_t) 1 << 63);
+                a.moveToDouble(1, A::RAX);
+                a.xorDouble(0, 1);
+                type = Value::REAL;
+            }
+            return true;
+        case Parser::BINARY_OPERATOR_NODE:
+            return compileBinary(c, node, types, exit, type);
+        default:
+            c.abort = "unsupported expression at row " + to_string(node->rowNumber);
+            return false;
+    }
+}
+
+bool Jit::compileBinary(Compiler &c, Parser::ASTNode *node, const Types &types, int exit, Value::Type &type) {
+    A &a = c.assembler;
+    Value::Type left, right;
+    if (node->op == Parser::OP_AND || node->op == Parser::OP_OR) {
+        // The right operand only runs if the left one does not decide.
+        A::Label decided = a.newLabel();
+        A::Label done = a.newLabel();
+        if (!compileExpression(c, node->child[0], types, exit, left)) return false;
+        compileTruth(c, left);
+        a.jump(node->op == Parser::OP_AND ? A::EQUAL : A::NOT_EQUAL, decided);
+        if (!compileExpression(c, node->child[1], types, exit, right)) return false;
+        compileTruth(c, right);
+        a.set(A::NOT_EQUAL, A::RAX);
+        a.jump(done);
+        a.bind(decided);
+        a.move(A::RAX, (uint64_t) (node->op == Parser::OP_OR));
+        a.bind(done);
+        type = Value::BOOL;
+        return true;
+    }
+    if (!compileExpression(c, node->child[0], types, exit, left)) return false;
+    pushValue(c, left);
+    if (!compileExpression(c, node->child[1], types, exit, right)) return false;
+    if (left == Value::INT && right == Value::INT) {
+        a.move(A::RCX, A::RAX);
+        a.pop(A::RAX);
+        c.stackDepth--;
+        return compileIntegers(c, node, exit, type);
+    }
+    // Anything else is combined and compared as reals, left in xmm0 and right in xmm1.
+    toDouble(c, right, 1);
+    if (left == Value::REAL) {
+        popDouble(c, 0);
+    } else {
+        a.pop(A::RAX);
+        c.stackDepth--;
+        toDouble(c, left, 0);
+    }
+    type = Value::REAL;
+    switch (node->op) {
+        case Parser::OP_ADD:
+            a.addDouble(0, 1);
+            return true;
+        case Parser::OP_SUB:
+            a.subtractDouble(0, 1);
+            return true;
+        case Parser::OP_MUL:
+            a.multiplyDouble(0, 1);
+            return true;
+        case Parser::OP_DIV:
+            a.divideDouble(0, 1);
+            return true;
+        case Parser::OP_MOD: {
+            // The stack is 16 byte aligned at the call if an odd number of temporaries is on it.
+            bool align = c.stackDepth % 2 == 0;
+            if (align) a.subtract(A::RSP, 8);
+            double (*remainder)(double, double) = fmod;
+            a.move(A::RAX, (uint64_t) remainder);
+            a.call(A::RAX);
+            if (align) a.add(A::RSP, 8);
+            return true;
+        }
+        default:
+            break;
+    }
+    type = Value::BOOL;
+    switch (node->op) {
+        case Parser::OP_LT: // Unordered compares are false: CF is set, so "above" fails.
+            a.compareDouble(1, 0);
+            a.set(A::ABOVE, A::RAX);
+            return true;
+        case Parser::OP_LE:
+            a.compareDouble(1, 0);
+            a.set(A::ABOVE_EQUAL, A::RAX);
+            return true;
+        case Parser::OP_GT:
+            a.compareDouble(0, 1);
+            a.set(A::ABOVE, A::RAX);
+            return true;
+        case Parser::OP_GE:
+            a.compareDouble(0, 1);
+            a.set(A::ABOVE_EQUAL, A::RAX);
+            return true;
+        case Parser::OP_EQ:
+        case Parser::OP_NE: {
+            A::Label unordered = a.newLabel();
+            a.compareDouble(0, 1);
+            a.move(A::RAX, (uint64_t) (node->op == Parser::OP_NE));
+            a.jump(A::PARITY, unordered);
+            a.set(node->op == Parser::OP_EQ ? A::EQUAL : A::NOT_EQUAL, A::RAX);
+            a.bind(unordered);
+            return true;
+        }
+        default:
+            c.abort = "unsupported operator: " + string(node->text);
+            return false;
+    }
+}
+
+// Left in rax, right in rcx. Results the walker would promote to a real exit: overflows
+// and remainders by zero, which are NaN. Divisions are integers without a remainder and
+// reals otherwise, the trace gives the type the recording saw and exits on the other.
+bool Jit::compileIntegers(Compiler &c, Parser::ASTNode *node, int exit, Value::Type &type) {
+    A &a = c.assembler;
+    Parser::Operator op = node->op;
+    type = Value::INT;
+    switch (op) {
+        case Parser::OP_ADD:
+            a.add(A::RAX, A::RCX);
+            a.jump(A::OVERFLOW, c.exitLabels[exit]);
+            return true;
+        case Parser::OP_SUB:
+            a.subtract(A::RAX, A::RCX);
+            a.jump(A::OVERFLOW, c.exitLabels[exit]);
+            return true;
+        case Parser::OP_MUL:
+            a.multiply(A::RAX, A::RCX);
+            a.jump(A::OVERFLOW, c.exitLabels[exit]);
+            return true;
+        case Parser::OP_DIV:
+        case Parser::OP_MOD:
+            // Division by -1 always gives an integer, and traps for the smallest one.
+            a.test(A::RCX, A::RCX);
+            a.jump(A::EQUAL, c.exitLabels[exit]);
+            a.move(A::RDX, (uint64_t) -1);
+            a.compare(A::RCX, A::RDX);
+            a.jump(A::EQUAL, c.exitLabels[exit]);
+            a.move(A::RSI, A::RAX);
+            a.signExtend();
+            a.divide(A::RCX);
+            if (op == Parser::OP_MOD) {
+                a.move(A::RAX, A::RDX);
+                return true;
+            }
+            return compileQuotient(c, node, exit, type);
+        default:
+            break;
+    }
+    type = Value::BOOL;
+    a.compare(A::RAX, A::RCX);
+    switch (op) {
+        case Parser::OP_LT:
+            a.set(A::LESS, A::RAX);
+            return true;
+        case Parser::OP_LE:
+            a.set(A::LESS_EQUAL, A::RAX);
+            return true;
+        case Parser::OP_GT:
+            a.set(A::GREATER, A::RAX);
+            return true;
+        case Parser::OP_GE:
+            a.set(A::GREATER_EQUAL, A::RAX);
+            return true;
+        case Parser::OP_EQ:
+            a.set(A::EQUAL, A::RAX);
+            return true;
+        case Parser::OP_NE:
+            a.set(A::NOT_EQUAL, A::RAX);
+            return true;
+        default:
+            c.abort = "unsupported operator";
+            return false;
+    }
+}
+
+// After idiv: the dividend in rsi, the divisor in rcx, the quotient in rax and the remainder in rdx.
+bool Jit::compileQuotient(Compiler &c, Parser::ASTNode *node, int exit, Value::Type &type) {
+    A &a = c.assembler;
+    uint8_t seen = c.loop->quotients[node] & (1 << Value::INT | 1 << Value::REAL);
+    if (seen == 0) {
+        a.jump(c.exitLabels[guessExit(c, exit)]); // Never divided integers here while recording.
+        type = Value::REAL;
+        return true;
+    }
+    a.test(A::RDX, A::RDX);
+    if (seen == 1 << Value::INT) {
+        a.jump(A::NOT_EQUAL, c.exitLabels[guessExit(c, exit)]);
+        type = Value::INT;
+        return true;
+    }
+    // Only a recording that saw no exact quotient makes one a guess, a loop seeing both stays a real.
+    a.jump(A::EQUAL, c.exitLabels[seen == 1 << Value::REAL ? guessExit(c, exit) : exit]);
+    a.move(A::RAX, A::RSI);
+    toDouble(c, Value::INT, 0);
+    a.move(A::RAX, A::RCX);
+    toDouble(c, Value::INT, 1);
+    a.divideDouble(0, 1);
+    type = Value::REAL;
+    return true;
+}
+
+// Sets ZF if the value is falsy: zero, false or a real that is not a number.
+void Jit::compileTruth(Compiler &c, Value::Type type) {
+    if (type == Value::REAL) {
+        c.assembler.xorDouble(1, 1);
+        c.assembler.compareDouble(0, 1);
+    } else {
+        c.assembler.test(A::RAX, A::RAX);
+    }
+}
+
+// Convert the value to a real in the given register. Clearing it first saves cvtsi2sd
+// from waiting for its old contents.
+void Jit::toDouble(Compiler &c, Value::Type type, int xmm) {
+    if (type == Value::REAL) {
+        if (xmm != 0) c.assembler.moveDouble(xmm, 0);
+        return;
+    }
+    c.assembler.xorDouble(xmm, xmm);
+    c.assembler.convertToDouble(xmm, A::RAX);
+}
+
+// Load the value at address, which may be rax.
+void Jit::loadValue(Compiler &c, Assembler::Register address, Value::Type type) {
+    A &a = c.assembler;
+    if (type == Value::REAL) {
+        a.loadDouble(0, address, PAYLOAD_OFFSET);
+    } else if (type == Value::INT) {
+        a.load(A::RAX, address, PAYLOAD_OFFSET);
+    } else {
+        a.loadByte(A::RAX, address, PAYLOAD_OFFSET);
+    }
+}
+
+// Store the value, in source or xmm0, at address. Whatever was there holds no reference.
+void Jit::storeValue(Compiler &c, Assembler::Register address, Assembler::Register source, Value::Type type) {
+    A &a = c.assembler;
+    if (type == Value::REAL) {
+        a.storeDouble(address, PAYLOAD_OFFSET, 0);
+    } else {
+        a.store(address, PAYLOAD_OFFSET, source);
+    }
+    a.store32(address, TYPE_OFFSET, type);
+}
+
+void Jit::pushValue(Compiler &c, Value::Type type) {
+    if (type == Value::REAL) {
+        c.assembler.subtract(A::RSP, 8);
+        c.assembler.storeDouble(A::RSP, 0, 0);
+    } else {
+        c.assembler.push(A::RAX);
+    }
+    c.stackDepth++;
+}
+
+void Jit::popDouble(Compiler &c, int xmm) {
+    c.assembler.loadDouble(xmm, A::RSP, 0);
+    c.assembler.add(A::RSP, 8);
+    c.stackDepth--;
+}
+
+// Whether evaluating the expression can have an effect. Calls may.
+bool Jit::isPure(Parser::ASTNode *node) {
+    if (node->type == Parser::FUNCTION_CALL_NODE) return false;
+    for (auto *child : node->child) {
+        for (; child != nullptr; child = child->next) {
+            if (!isPure(child)) return false;
+        }
+    }
+    return true;
+}
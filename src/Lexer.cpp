@@ -1,4 +1,6 @@
 #include "Lexer.h"
+#include "Scanner.h"
+#include <array>
 #include <iostream>
 #include <string>
 #include <utility>
@@ -7,116 +9,190 @@ using namespace std;
 
 Lexer::Lexer() {
     rowNumber = 0;
-    rowBufferPos = 0;
-    initKeywordsAndSymbols();
+    begin = cursor = end = nullptr;
+    interactive = false;
 }
 
 void Lexer::tokenizeInput(string i) {
-    input = std::move(i);
+    line = std::move(i);
     rowNumber++;
-    rowBuffer = input;
-    rowBuffer += '\n';
-    rowBufferPos = 0;
+    begin = cursor = line.data();
+    end = cursor + line.size();
+    interactive = true;
 }
 
 void Lexer::openFile(const string &filename) {
-    file.open(filename);
-    if (file.fail()) {
+    if (!file.open(filename)) {
         cerr << "file " << filename << " cannot not be open." << endl;
         exit(-1);
     }
+    rowNumber = 1;
+    begin = cursor = file.data();
+    end = cursor + file.size();
+    interactive = false;
 }
 
 void Lexer::closeFile() {
     file.close();
+    begin = cursor = end = nullptr;
 }
 
-void Lexer::initKeywordsAndSymbols() {
-    keywords.insert("function");
-    keywords.insert("var");
-    keywords.insert("let");
-    keywords.insert("const");
-    keywords.insert("true");
-    keywords.insert("false");
-    keywords.insert("this");
-    keywords.insert("if");
-    keywords.insert("else");
-    keywords.insert("while");
-    keywords.insert("return");
-    keywords.insert("undefined");
-    keywords.insert("null");
-    keywords.insert("for");
-    keywords.insert("break");
-    keywords.insert("continue");
-    keywords.insert("class");
+// Keywords are recognised with a perfect hash: no two keywords share a slot, so a
+// word is a keyword only if it equals the one keyword hashed to its slot.
+namespace {
+class Keyword {
+public:
+    const char *text;
+    Lexer::TokenKind kind;
+};
 
-    symbols.insert("{");
-    symbols.insert("}");
-    symbols.insert("(");
-    symbols.insert(")");
-    symbols.insert("[");
-    symbols.insert("]");
-    symbols.insert(".");
-    symbols.insert(",");
-    symbols.insert(";");
-    symbols.insert("+");
-    symbols.insert("-");
-    symbols.insert("*");
-    symbols.insert("/");
-    symbols.insert("%");
-    symbols.insert("&");
-    symbols.insert("|");
-    symbols.insert("!");
-    symbols.insert("<");
-    symbols.insert(">");
-    symbols.insert("=");
-    symbols.insert(">=");
-    symbols.insert("<=");
-    symbols.insert("==");
-    symbols.insert("!=");
-    symbols.insert("&&");
-    symbols.insert("||");
+const Keyword KEYWORDS[] = {
+        {"function", Lexer::KW_FUNCTION},
+        {"var", Lexer::KW_VAR},
+        {"let", Lexer::KW_LET},
+        {"const", Lexer::KW_CONST},
+        {"true", Lexer::KW_TRUE},
+        {"false", Lexer::KW_FALSE},
+        {"this", Lexer::KW_THIS},
+        {"if", Lexer::KW_IF},
+        {"else", Lexer::KW_ELSE},
+        {"while", Lexer::KW_WHILE},
+        {"return", Lexer::KW_RETURN},
+        {"undefined", Lexer::KW_UNDEFINED},
+        {"null", Lexer::KW_NULL},
+        {"for", Lexer::KW_FOR},
+        {"break", Lexer::KW_BREAK},
+        {"continue", Lexer::KW_CONTINUE},
+        {"class", Lexer::KW_CLASS}
+};
+
+const size_t KEYWORD_SLOTS = 32;
+
+constexpr size_t keywordHash(const char *word, size_t length) {
+    return ((unsigned char) word[0] * 5 + (unsigned char) word[length - 1] * 4 + length) % KEYWORD_SLOTS;
 }
 
-void Lexer::resetRow() {
-    rowNumber = 0;
+constexpr size_t length(const char *text) {
+    return *text ? 1 + length(text + 1) : 0;
+}
+
+constexpr std::array<Keyword, KEYWORD_SLOTS> makeKeywordTable() {
+    std::array<Keyword, KEYWORD_SLOTS> table{};
+    for (const Keyword &keyword : KEYWORDS) {
+        size_t slot = keywordHash(keyword.text, length(keyword.text));
+        if (table[slot].text != nullptr) throw "keyword hash collision";
+        table[slot] = keyword;
+    }
+    return table;
+}
+
+constexpr std::array<Keyword, KEYWORD_SLOTS> KEYWORD_TABLE = makeKeywordTable();
 }
 
-bool Lexer::isKeyword(const string &str) {
-    return keywords.find(str) != keywords.end();
+Lexer::TokenKind Lexer::keywordKind(string_view word) {
+    const Keyword &keyword = KEYWORD_TABLE[keywordHash(word.data(), word.size())];
+    if (keyword.text != nullptr && word == keyword.text) return keyword.kind;
+    return NO_KIND;
+}
+
+// Kind of a symbol starting with c, extended to two characters if next completes one.
+Lexer::TokenKind Lexer::symbolKind(char c, char next, bool &twoChars) {
+    twoChars = true;
+    switch (c) {
+        case '=':
+            if (next == '=') return EQUAL;
+            break;
+        case '!':
+            if (next == '=') return NOT_EQUAL;
+            break;
+        case '<':
+            if (next == '=') return LESS_EQUAL;
+            break;
+        case '>':
+            if (next == '=') return GREATER_EQUAL;
+            break;
+        case '&':
+            if (next == '&') return AND;
+            break;
+        case '|':
+            if (next == '|') return OR;
+            break;
+        default:
+            break;
+    }
+    twoChars = false;
+    switch (c) {
+        case '{':
+            return LEFT_BRACE;
+        case '}':
+            return RIGHT_BRACE;
+        case '(':
+            return LEFT_PAREN;
+        case ')':
+            return RIGHT_PAREN;
+        case '[':
+            return LEFT_BRACKET;
+        case ']':
+            return RIGHT_BRACKET;
+        case '.':
+            return DOT;
+        case ',':
+            return COMMA;
+        case ';':
+            return SEMICOLON;
+        case '+':
+            return PLUS;
+        case '-':
+            return MINUS;
+        case '*':
+            return STAR;
+        case '/':
+            return SLASH;
+        case '%':
+            return PERCENT;
+        case '&':
+            return AMPERSAND;
+        case '|':
+            return PIPE;
+        case '!':
+            return BANG;
+        case '<':
+            return LESS;
+        case '>':
+            return GREATER;
+        case '=':
+            return ASSIGN;
+        default:
+            return NO_KIND;
+    }
 }
 
-bool Lexer::isSymbol(const string &str) {
-    return symbols.find(str) != symbols.end();
+void Lexer::resetRow() {
+    rowNumber = 0;
 }
 
+// The cursor moves past the end too, so that rollBack() stays symmetric.
 char Lexer::nextChar() {
-    if (rowBufferPos >= rowBuffer.size()) {
-        rowNumber++;
-        if (input.empty()) { // Tokenize file.
-            getline(file, rowBuffer);
-            rowBuffer += '\n';
-            if (!file.fail()) {
-                rowBufferPos = 0;
-                return rowBuffer[rowBufferPos++];
-            } else {
-                return EOF;
-            }
-        } else { // Tokenize input string.
-            return '\0'; // Means end of line.
-        }
-    } else {
-        return rowBuffer[rowBufferPos++];
+    if (cursor >= end) {
+        cursor++;
+        return interactive ? '\0' : EOF; // '\0' means end of line.
     }
+    char c = *cursor++;
+    if (c == '\n') rowNumber++;
+    return c;
 }
 
 void Lexer::rollBack() {
-    rowBufferPos--;
+    cursor--;
+    if (cursor < end && *cursor == '\n') rowNumber--;
 }
 
 Lexer::Token Lexer::nextToken() {
     char currentChar = nextChar();
     Token token;
+    token.type = NONE;
+    token.kind = NO_KIND;
+    token.atom = AtomTable::NO_ATOM;
     while (true) {
         // Check EOF.
         if (currentChar == EOF) {
@@ -129,114 +205,76 @@ Lexer::Token Lexer::nextToken() {
             break;
         }
         // Skip all blank characters.
-        if (isspace(currentChar)) {
+        if (Scanner::is(currentChar, Scanner::SPACE)) {
+            unsigned newlines = 0;
+            cursor = Scanner::skipSpace(cursor, end, newlines);
+            rowNumber += newlines;
             currentChar = nextChar();
             continue;
         }
+        const char *start = cursor - 1;
         // Construct identifier and keyword token.
-        if (isalpha(currentChar) || currentChar == '_') {
+        if (Scanner::is(currentChar, Scanner::ALPHA)) {
             token.type = ID;
-            token.value += currentChar;
-            currentChar = nextChar();
-            while (isalpha(currentChar) || currentChar == '_' || isdigit(currentChar)) {
-                token.value += currentChar;
-                currentChar = nextChar();
+            cursor = Scanner::skipIdentifier(cursor, end);
+            token.value = string_view(start, cursor - start);
+            token.kind = keywordKind(token.value);
+            if (token.kind != NO_KIND) {
+                token.type = KEYWORD;
+            } else {
+                token.atom = AtomTable::intern(token.value);
             }
-            rollBack();
-            if (isKeyword(token.value)) token.type = KEYWORD;
             // if(token.value == "true" || token.value == "false") token.type = BOOL;
             break;
         }
         // Construct int and real token.
-        if (isdigit(currentChar)) {
-            token.value += currentChar;
-            currentChar = nextChar();
-            while (true) {
-                if (isdigit(currentChar)) {
-                    token.value += currentChar;
-                    currentChar = nextChar();
-                    continue;
-                }
-                if (currentChar == '.') {
-                    if (token.type != REAL) {
-                        token.value += currentChar;
-                        token.type = REAL;
-                        currentChar = nextChar();
-                        continue;
-                    } else {
-                        break;
-                    }
-                }
-                break;
+        if (Scanner::is(currentChar, Scanner::DIGIT)) {
+            token.type = INT;
+            cursor = Scanner::skipDigits(cursor, end);
+            if (cursor < end && *cursor == '.') {
+                token.type = REAL;
+                cursor = Scanner::skipDigits(cursor + 1, end);
             }
-            rollBack();
-            if (token.type != REAL) token.type = INT;
+            token.value = string_view(start, cursor - start);
             break;
         }
-        // Construct string token.
+        // Construct string token. Escapes are kept as written.
         if (currentChar == '"') {
             char lastChar = '\0';
+            start = cursor;
             currentChar = nextChar();
             token.type = STRING;
-            while (true) {
-                // The end of string.
-                if (lastChar != '\\' && currentChar == '\"') {
-                    if (lastChar != '\0') token.value += lastChar;
+            while (lastChar == '\\' || currentChar != '\"') {
+                if (currentChar == EOF || currentChar == '\0') {
+                    error("unterminated string", '\0');
                     break;
-                } else {
-                    if (lastChar != '\0') token.value += lastChar;
-                    lastChar = currentChar;
-                    currentChar = nextChar();
-                    continue;
                 }
+                lastChar = currentChar;
+                currentChar = nextChar();
             }
+            token.value = string_view(start, cursor - 1 - start);
             break;
         }
         // Construct char token.
         if (currentChar == '\'') {
+            start = cursor;
+            currentChar = nextChar();
+            if (currentChar == '\\') currentChar = nextChar();
             currentChar = nextChar();
-            if (currentChar != '\\') {
-                token.value = currentChar;
-                currentChar = nextChar();
-            } else {
-                token.value = currentChar;
-                currentChar = nextChar();
-                token.value += currentChar;
-                currentChar = nextChar();
-            }
             if (currentChar != '\'') {
                 error("too much characters in single quote", currentChar);
             }
+            token.value = string_view(start, cursor - 1 - start);
             token.type = CHAR;
             break;
         }
         // Construct symbol token.
-        std::string str(1, currentChar);
-        if (Lexer::isSymbol(str)) {
+        if (Scanner::is(currentChar, Scanner::SYMBOL)) {
+            bool twoChars;
             token.type = Lexer::SYMBOL;
-            token.value += str;
-            if (currentChar == '=' || currentChar == '>' || currentChar == '<' || currentChar == '!') {
-                currentChar = nextChar();
-                if (currentChar == '=') {
-                    token.value += '=';
-                } else {
-                    rollBack();
-                }
-            } else if (currentChar == '&') {
-                currentChar = nextChar();
-                if (currentChar == '&') {
-                    token.value += '&';
-                } else {
-                    rollBack();
-                }
-            } else if (currentChar == '|') {
-                currentChar = nextChar();
-                if (currentChar == '|') {
-                    token.value += '|';
-                } else {
-                    rollBack();
-                }
-            }
+            token.kind = symbolKind(currentChar, cursor < end ? *cursor : '\0', twoChars);
+            if (twoChars) cursor++;
+            token.value = string_view(start, cursor - start);
             break;
         }
         error(&"unexpected character "[currentChar], currentChar);
@@ -251,7 +289,7 @@ void Lexer::print(const Lexer::Token &token) {
 
 string Lexer::tokenToString(const Lexer::Token &token) {
     std::string tokenType;
-    std::string tokenValue = token.value;
+    std::string tokenValue(token.value);
     switch (token.type) {
         case Lexer::ID:
             tokenType = "ID";
@@ -295,8 +333,10 @@ string Lexer::tokenToString(const Lexer::Token &token) {
 
 void Lexer::error(const std::string &message, char currentChar) {
     if (currentChar != '\0') {
+        const char *lineStart = cursor - 1;
+        while (lineStart > begin && lineStart[-1] != '\n') lineStart--;
         cerr << "[Lexer] [Error]: " << message << " when process character '" << currentChar << "' at row " << rowNumber
-             << " col " << rowBufferPos << "." << endl;
+             << " col " << cursor - lineStart << "." << endl;
     } else {
         cerr << "[Lexer] [Error]: " << message << "." << endl;
     }
@@ -0,0 +1,56 @@
+#include "MappedFile.h"
+#include <fstream>
+#include <iterator>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+MappedFile::MappedFile() {
+    mapping = nullptr;
+    length = 0;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const string &filename) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *address = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            madvise(address, (size_t) info.st_size, MADV_SEQUENTIAL);
+            mapping = address;
+            length = (size_t) info.st_size;
+        }
+    }
+    ::close(fd);
+    if (mapping == nullptr) {
+        ifstream file(filename, ios::binary);
+        if (file.fail()) return false;
+        contents.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        length = contents.size();
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapping != nullptr) munmap(mapping, length);
+    mapping = nullptr;
+    length = 0;
+    contents.clear();
+}
+
+const char *MappedFile::data() const {
+    return mapping != nullptr ? static_cast<const char *>(mapping) : contents.data();
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
@@ -0,0 +1,97 @@
+#include "MemoTable.h"
+#include <cstring>
+#include <functional>
+
+using namespace std;
+
+static const size_t CAPACITY = 4096; // Entries per function, a power of two.
+
+// Small doubles differ only in their high bits, so every bit has to reach the slot index.
+static inline uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+size_t MemoTable::hash(const Value *arguments, size_t count) {
+    uint64_t h = count;
+    for (size_t i = 0; i < count; ++i) {
+        const Value &argument = arguments[i];
+        uint64_t bits = 0;
+        switch (argument.getType()) {
+            case Value::BOOL:
+                bits = argument.getBool();
+                break;
+            case Value::INT:
+                bits = (uint64_t) argument.getInt();
+                break;
+            case Value::REAL: {
+                double d = argument.getReal();
+                uint64_t raw;
+                memcpy(&raw, &d, sizeof(raw));
+                bits = raw;
+                break;
+            }
+            case Value::STRING:
+                bits = std::hash<string>()(argument.getString());
+                break;
+            default:
+                break;
+        }
+        h = mix(h ^ (bits + argument.getType()));
+    }
+    return (size_t) h;
+}
+
+bool MemoTable::same(const Value &left, const Value &right) {
+    if (left.getType() != right.getType()) return false;
+    switch (left.getType()) {
+        case Value::UNDEFINED:
+            return true;
+        case Value::BOOL:
+            return left.getBool() == right.getBool();
+        case Value::INT:
+            return left.getInt() == right.getInt();
+        case Value::REAL: {
+            double l = left.getReal(), r = right.getReal();
+            return memcmp(&l, &r, sizeof(double)) == 0;
+        }
+        case Value::STRING:
+            return left.getString() == right.getString();
+        default:
+            return false; // Arrays are never keys, their elements may change.
+    }
+}
+
+bool MemoTable::find(const Value *arguments, size_t count, Value &result) {
+    if (!entries.empty()) {
+        const Entry &entry = entries[hash(arguments, count) & (CAPACITY - 1)];
+        if (entry.used && entry.arguments.size() == count) {
+            size_t i = 0;
+            while (i < count && same(entry.arguments[i], arguments[i])) i++;
+            if (i == count) {
+                hits++;
+                result = entry.result;
+                return true;
+            }
+        }
+    }
+    misses++;
+    return false;
+}
+
+void MemoTable::insert(const Value *arguments, size_t count, const Value &result) {
+    if (entries.empty()) entries.resize(CAPACITY);
+    Entry &entry = entries[hash(arguments, count) & (CAPACITY - 1)];
+    entry.arguments.assign(arguments, arguments + count);
+    entry.result = result;
+    entry.used = true;
+}
+
+size_t MemoTable::getHits() const {
+    return hits;
+}
+
+size_t MemoTable::getMisses() const {
+    return misses;
+}
@@ -0,0 +1,314 @@
+#include "Optimizer.h"
+#include "Interpreter.h"
+#include <iostream>
+
+using namespace std;
+
+Parser::ASTNode *Optimizer::optimize(Parser::ASTNode *root, bool isProgram) {
+    scopes.clear();
+    scopes.emplace_back();
+    bindings.clear();
+    assigned.clear();
+    propagate = isProgram;
+    conditional = functionDepth = topLevelCalls = 0;
+    folded = propagated = removed = 0;
+    if (isProgram) {
+        countBindings(root);
+        root = optimizeList(root);
+    } else {
+        for (auto *node = root; node != nullptr; node = node->next) {
+            optimizeStatement(node);
+        }
+    }
+    log("folded " + to_string(folded) + " expressions, propagated " + to_string(propagated) +
+        " constants, removed " + to_string(removed) + " statements");
+    return root;
+}
+
+void Optimizer::setDebugMode(bool enable) {
+    debug = enable;
+}
+
+void Optimizer::log(const string &message, const std::string &extra) {
+    if (!debug) return;
+    cout << "[Optimizer] [Log]: " << message << extra << endl;
+}
+
+// A constant is only propagated if its declaration is the one binding of its name and
+// the name is never assigned, so every reference that sees the declaration reads its value.
+void Optimizer::countBindings(Parser::ASTNode *node) {
+    for (; node != nullptr; node = node->next) {
+        if (node->type == Parser::VAR_DECLARE_NODE || node->type == Parser::ARGUMENT_NODE) {
+            bindings[node->atom]++;
+        } else if (node->type == Parser::VAR_ASSIGN_NODE) {
+            assigned.insert(node->atom);
+        }
+        for (auto *child : node->child) {
+            countBindings(child);
+        }
+    }
+}
+
+bool Optimizer::isConstant(Parser::ASTNode *node) {
+    if (node == nullptr) return false;
+    switch (node->type) {
+        case Parser::INT_NODE:
+        case Parser::REAL_NODE:
+        case Parser::STRING_NODE:
+        case Parser::CHAR_NODE:
+        case Parser::BOOL_NODE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Whether the statements declare something the rest of the program can see: variables
+// share the scope of enclosing if branches, and the compiler hoists every function.
+bool Optimizer::declares(Parser::ASTNode *node) {
+    for (; node != nullptr; node = node->next) {
+        if (node->type == Parser::VAR_DECLARE_NODE || node->type == Parser::FUNCTION_DECLARE_NODE) return true;
+        if (node->type == Parser::IF_NODE && (declares(node->child[1]) || declares(node->child[2]))) return true;
+        for (auto *child : node->child) {
+            if (declaresFunction(child)) return true;
+        }
+    }
+    return false;
+}
+
+bool Optimizer::declaresFunction(Parser::ASTNode *node) {
+    for (; node != nullptr; node = node->next) {
+        if (node->type == Parser::FUNCTION_DECLARE_NODE) return true;
+        for (auto *child : node->child) {
+            if (declaresFunction(child)) return true;
+        }
+    }
+    return false;
+}
+
+int Optimizer::countStatements(Parser::ASTNode *node) {
+    int count = 0;
+    for (; node != nullptr; node = node->next) count++;
+    return count;
+}
+
+// Optimize a statement list and return its new head. The branch of an if with a constant
+// condition is spliced into the list in place of the if, which is safe since branches
+// share the scope of the enclosing block. A list left empty keeps its first node as an
+// empty statement, so both engines see the same shape as for an empty block.
+Parser::ASTNode *Optimizer::optimizeList(Parser::ASTNode *node) {
+    Parser::ASTNode *first = node;
+    Parser::ASTNode *head = nullptr;
+    Parser::ASTNode **link = &head;
+    while (node != nullptr) {
+        Parser::ASTNode *next = node->next;
+        optimizeStatement(node);
+        if (node->type == Parser::IF_NODE && isConstant(node->child[0])) {
+            bool condition = node->child[0]->value.toBool();
+            Parser::ASTNode *taken = condition ? node->child[1] : node->child[2];
+            Parser::ASTNode *dropped = condition ? node->child[2] : node->child[1];
+            if (!declares(dropped)) {
+                removed += countStatements(dropped) + 1;
+                *link = taken;
+                while (*link != nullptr) link = &(*link)->next;
+                node = next;
+                continue;
+            }
+        } else if (node->type == Parser::WHILE_NODE && isConstant(node->child[0]) &&
+                   !node->child[0]->value.toBool() && !declaresFunction(node->child[1])) {
+            removed += countStatements(node->child[1]) + 1;
+            node = next;
+            continue;
+        }
+        *link = node;
+        link = &node->next;
+        bool jumps = node->type == Parser::RETURN_NODE || node->type == Parser::BREAK_NODE ||
+                     node->type == Parser::CONTINUE_NODE;
+        if (jumps && next != nullptr && !declares(next)) {
+            removed += countStatements(next);
+            break;
+        }
+        node = next;
+    }
+    *link = nullptr;
+    if (head == nullptr && first != nullptr) {
+        *first = Parser::ASTNode();
+        head = first;
+    }
+    return head;
+}
+
+void Optimizer::optimizeStatement(Parser::ASTNode *node) {
+    switch (node->type) {
+        case Parser::NONE:
+            break;
+        case Parser::VAR_DECLARE_NODE:
+            fold(node->child[0]);
+            declareConstant(node);
+            break;
+        case Parser::VAR_ASSIGN_NODE:
+            fold(node->child[1]);
+            fold(node->child[0]);
+            break;
+        case Parser::IF_NODE:
+            fold(node->child[0]);
+            conditional++;
+            node->child[1] = optimizeList(node->child[1]);
+            node->child[2] = optimizeList(node->child[2]);
+            conditional--;
+            break;
+        case Parser::WHILE_NODE: {
+            int outer = conditional;
+            conditional = 0;
+            scopes.emplace_back();
+            fold(node->child[0]);
+            scopes.emplace_back();
+            node->child[1] = optimizeList(node->child[1]);
+            scopes.pop_back();
+            scopes.pop_back();
+            conditional = outer;
+            break;
+        }
+        case Parser::FOR_NODE: {
+            int outer = conditional;
+            conditional = 0;
+            scopes.emplace_back();
+            if (node->child[0] != nullptr) optimizeStatement(node->child[0]); // Initialization
+            fold(node->child[1]); // Condition
+            if (node->child[2] != nullptr) optimizeStatement(node->child[2]); // Update
+            scopes.emplace_back();
+            node->child[3] = optimizeList(node->child[3]); // Body
+            scopes.pop_back();
+            scopes.pop_back();
+            conditional = outer;
+            break;
+        }
+        case Parser::FUNCTION_DECLARE_NODE: {
+            int outer = conditional;
+            conditional = 0;
+            functionDepth++;
+            scopes.emplace_back();
+            scopes.back().isFunction = true;
+            node->child[1] = optimizeList(node->child[1]);
+            scopes.pop_back();
+            functionDepth--;
+            conditional = outer;
+            break;
+        }
+        case Parser::RETURN_NODE:
+            fold(node->child[0]);
+            break;
+        default:
+            fold(node);
+            break;
+    }
+}
+
+// Replace constant subexpressions by literals in place, so lists the node is part of stay linked.
+void Optimizer::fold(Parser::ASTNode *node) {
+    if (node == nullptr) return;
+    switch (node->type) {
+        case Parser::EXPRESSION_NODE:
+            fold(node->child[0]);
+            if (isConstant(node->child[0])) {
+                node->text = node->child[0]->text;
+                makeConstant(node, node->child[0]->value);
+            }
+            break;
+        case Parser::NEGATIVE_NODE:
+            fold(node->child[0]);
+            if (isConstant(node->child[0])) {
+                makeConstant(node, Value::negate(node->child[0]->value));
+                folded++;
+            }
+            break;
+        case Parser::BINARY_OPERATOR_NODE:
+            fold(node->child[0]);
+            fold(node->child[1]);
+            if ((node->op == Parser::OP_AND || node->op == Parser::OP_OR) && isConstant(node->child[0]) &&
+                node->child[0]->value.toBool() == (node->op == Parser::OP_OR)) {
+                // The left operand decides, the right one never runs.
+                makeConstant(node, Value::boolean(node->op == Parser::OP_OR));
+                folded++;
+            } else if (node->op != Parser::OP_NONE && isConstant(node->child[0]) && isConstant(node->child[1])) {
+                makeConstant(node, Interpreter::applyOperator(node->op, node->child[0]->value, node->child[1]->value));
+                folded++;
+            }
+            break;
+        case Parser::VAR_NODE: {
+            Parser::ASTNode *literal = propagate ? lookupConstant(node) : nullptr;
+            if (literal != nullptr) {
+                node->text = literal->text;
+                node->atom = AtomTable::NO_ATOM;
+                makeConstant(node, literal->value);
+                propagated++;
+            }
+            break;
+        }
+        case Parser::FUNCTION_CALL_NODE:
+            if (functionDepth == 0) topLevelCalls++;
+            for (auto *argument = node->child[0]; argument != nullptr; argument = argument->next) {
+                fold(argument);
+            }
+            break;
+        case Parser::ARRAY_DECLARE_NODE:
+            for (auto *element = node->child[0]; element != nullptr; element = element->next) {
+                fold(element);
+            }
+            break;
+        case Parser::ARRAY_ACCESS_NODE:
+            fold(node->child[0]);
+            break;
+        default:
+            break;
+    }
+}
+
+void Optimizer::makeConstant(Parser::ASTNode *node, const Value &value) {
+    switch (value.getType()) {
+        case Value::BOOL:
+            node->type = Parser::BOOL_NODE;
+            break;
+        case Value::INT:
+            node->type = Parser::INT_NODE;
+            break;
+        case Value::REAL:
+            node->type = Parser::REAL_NODE;
+            break;
+        case Value::STRING:
+            node->type = Parser::STRING_NODE;
+            break;
+        default:
+            return;
+    }
+    node->value = value;
+    node->op = Parser::OP_NONE;
+    node->child[0] = node->child[1] = node->child[2] = node->child[3] = nullptr;
+}
+
+// Declarations inside an if branch may not run, and those in loop headers or bodies are
+// scoped to the loop, so only their own scope and nested ones see the constant.
+void Optimizer::declareConstant(Parser::ASTNode *node) {
+    if (!propagate || !node->isConst || conditional > 0 || !isConstant(node->child[0])) return;
+    if (bindings[node->atom] != 1 || assigned.count(node->atom) > 0) return;
+    scopes.back().constants[node->atom] = {node->child[0], topLevelCalls == 0};
+}
+
+// Same visibility as the resolver: a function sees its own scopes and the global scope.
+// A global constant is only seen from inside functions if no call ran before it was
+// declared, since the compiler hoists functions and a call may read it uninitialized.
+Parser::ASTNode *Optimizer::lookupConstant(Parser::ASTNode *node) {
+    bool inFunction = false;
+    for (int i = (int) scopes.size() - 1; i > 0; --i) {
+        auto iter = scopes[i].constants.find(node->atom);
+        if (iter != scopes[i].constants.end()) return iter->second.literal;
+        if (scopes[i].isFunction) {
+            inFunction = true;
+            break;
+        }
+    }
+    auto iter = scopes[0].constants.find(node->atom);
+    if (iter == scopes[0].constants.end()) return nullptr;
+    if (inFunction && !iter->second.beforeCalls) return nullptr;
+    return iter->second.literal;
+}
@@ -2,45 +2,73 @@
 #include <iostream>
 #include <string>
 #include <cassert>
+#include <cerrno>
+#include <cstdlib>
 #include <utility>
 
 using namespace std;
 
 Parser::Parser() {
     root = nullptr;
+    position = 0;
+    arena.reset(new Arena);
 }
 
 void Parser::parseFile(std::string &filename) {
+    arena->release();
     lexer.openFile(filename);
+    loopDepth = 0;
+    tokenize();
     parseProgram();
 }
 
 Parser::ASTNode *Parser::parseInput(string input) {
+    arena->release();
     lexer.tokenizeInput(std::move(input));
+    loopDepth = 0;
+    tokenize();
     return parseStatement();
 }
 
-// Load next token.
-Lexer::Token Parser::getToken() {
-    if (rightTokenBuffer.empty()) {
-        auto token = lexer.nextToken();
-        leftTokenBuffer.push_back(token);
-        if (leftTokenBuffer.size() > 10) leftTokenBuffer.pop_front();
-    } else {
-        auto token = rightTokenBuffer.front();
-        rightTokenBuffer.pop_front();
-        leftTokenBuffer.push_back(token);
-    }
-    log("get token ", leftTokenBuffer.back());
-    return leftTokenBuffer.back();
+// The tree of the next parse normally reuses the arena of the last one.
+// Keep the last tree alive instead, e.g. because it declares functions.
+void Parser::keepAST() {
+    keptArenas.push_back(std::move(arena));
+    arena.reset(new Arena);
+}
+
+Parser::ASTNode *Parser::newNode() {
+    return arena->make<ASTNode>();
+}
+
+void Parser::setToken(ASTNode *node, const Lexer::Token &token) {
+    node->text = arena->copyString(token.value);
+    node->atom = token.atom;
+    node->rowNumber = token.rowNumber;
+}
+
+// Lex the whole source up front, up to the END_OF_FILE or END_OF_LINE token.
+void Parser::tokenize() {
+    tokens.clear();
+    position = 0;
+    do {
+        tokens.push_back(lexer.nextToken());
+    } while (tokens.back().type != Lexer::END_OF_FILE && tokens.back().type != Lexer::END_OF_LINE);
+}
+
+// Load next token. Past the end, the final token is returned again.
+const Lexer::Token &Parser::getToken() {
+    const Lexer::Token &token = tokens[min(position, tokens.size() - 1)];
+    position++;
+    log("get token ", token);
+    return token;
 }
 
 // Restore current token.
 void Parser::restoreToken() {
-    auto token = leftTokenBuffer.back();
-    leftTokenBuffer.pop_back();
-    rightTokenBuffer.push_front(token);
-    log("restore token ", token);
+    assert(position > 0);
+    position--;
+    log("restore token ", tokens[min(position, tokens.size() - 1)]);
 }
 
 void Parser::error(const string &message, const Lexer::Token &token) {
@@ -70,6 +98,49 @@ Parser::ASTNode *Parser::getAST() {
     return root;
 }
 
+// Whether a statement list can continue with this token.
+bool Parser::startsStatement(const Lexer::Token &token) {
+    switch (token.kind) {
+        case Lexer::KW_VAR:
+        case Lexer::KW_CONST:
+        case Lexer::KW_LET:
+        case Lexer::KW_FUNCTION:
+        case Lexer::KW_IF:
+        case Lexer::KW_WHILE:
+        case Lexer::KW_RETURN:
+        case Lexer::KW_FOR:
+        case Lexer::KW_BREAK:
+        case Lexer::KW_CONTINUE:
+            return true;
+        default:
+            return token.type == Lexer::ID;
+    }
+}
+
+// Map a relational or logical operator token to its operator code.
+Parser::Operator Parser::relationalOperator(Lexer::TokenKind kind) {
+    switch (kind) {
+        case Lexer::LESS_EQUAL:
+            return OP_LE;
+        case Lexer::GREATER_EQUAL:
+            return OP_GE;
+        case Lexer::EQUAL:
+            return OP_EQ;
+        case Lexer::LESS:
+            return OP_LT;
+        case Lexer::GREATER:
+            return OP_GT;
+        case Lexer::NOT_EQUAL:
+            return OP_NE;
+        case Lexer::AND:
+            return OP_AND;
+        case Lexer::OR:
+            return OP_OR;
+        default:
+            return OP_NONE;
+    }
+}
+
 void Parser::parseProgram() {
     root = parseStatementList();
 }
@@ -78,11 +149,7 @@ Parser::ASTNode *Parser::parseStatementList() {
     ASTNode *node = parseStatement();
     ASTNode *current = node;
     Lexer::Token token = getToken();
-    while (token.value == "var" || token.value == "const" ||
-           token.value == "let" || token.value == "function" ||
-           token.type == Lexer::ID || token.value == "if" ||
-           token.value == "while" || token.value == "return" ||
-           token.value == "for") {
+    while (startsStatement(token)) {
         restoreToken();
         current->next = parseStatement();
         current = current->next;
@@ -95,36 +162,46 @@ Parser::ASTNode *Parser::parseStatementList() {
 Parser::ASTNode *Parser::parseStatement() {
     Parser::ASTNode *node = nullptr;
     Lexer::Token token = getToken();
-    if (token.value == "if") {
-        restoreToken();
-        node = parseIfStatement();
-    } else if (token.value == "while") {
-        restoreToken();
-        node = parseWhileStatement();
-    } else if (token.value == "for") {
-        restoreToken();
-        node = parseForStatement();
-    } else if (token.value == "return") {
-        restoreToken();
-        node = parseReturnStatement();
-    } else if (token.value == "var" || token.value == "let" || token.value == "const") {
-        restoreToken();
-        node = parseDeclareStatement();
-    } else if (token.value == "function") {
-        restoreToken();
-        node = parseFunction();
-    } else if (token.type == Lexer::ID) {
+    switch (token.kind) {
+        case Lexer::KW_IF:
+            restoreToken();
+            return parseIfStatement();
+        case Lexer::KW_WHILE:
+            restoreToken();
+            return parseWhileStatement();
+        case Lexer::KW_FOR:
+            restoreToken();
+            return parseForStatement();
+        case Lexer::KW_RETURN:
+            restoreToken();
+            return parseReturnStatement();
+        case Lexer::KW_BREAK:
+        case Lexer::KW_CONTINUE:
+            restoreToken();
+            return parseJumpStatement();
+        case Lexer::KW_VAR:
+        case Lexer::KW_LET:
+        case Lexer::KW_CONST:
+            restoreToken();
+            return parseDeclareStatement();
+        case Lexer::KW_FUNCTION:
+            restoreToken();
+            return parseFunction();
+        default:
+            break;
+    }
+    if (token.type == Lexer::ID) {
         token = getToken();
-        if (token.value == "=" || token.value == "[") {
+        if (token.kind == Lexer::ASSIGN || token.kind == Lexer::LEFT_BRACKET) {
             restoreToken();
             restoreToken();
             node = parseAssignStatement();
-        } else if (token.value == "(") {
+        } else if (token.kind == Lexer::LEFT_PAREN) {
             restoreToken();
             restoreToken();
             node = parseCallExpression();
             token = getToken();
-            if (token.value != ";") restoreToken();
+            if (token.kind != Lexer::SEMICOLON) restoreToken();
         } else {
             // Four cases:
             // ID EOL
@@ -135,15 +212,15 @@ Parser::ASTNode *Parser::parseStatement() {
             restoreToken(); // Return the ID token.
             token = getToken(); // Get the ID token back.
             Lexer::Token nextToken = getToken(); // Discard token if its EOL or `;`.
-            if (nextToken.type != Lexer::END_OF_LINE && nextToken.value != ";") {
+            if (nextToken.type != Lexer::END_OF_LINE && nextToken.kind != Lexer::SEMICOLON) {
                 restoreToken();
             } else {
                 nextToken = getToken();
                 if (nextToken.type != Lexer::END_OF_LINE) restoreToken();
             }
-            node = new ASTNode;
+            node = newNode();
             node->type = VAR_NODE;
-            node->token = token;
+            setToken(node, token);
             log("this statement only has one ID", token);
         }
     } else {
@@ -153,40 +230,41 @@ Parser::ASTNode *Parser::parseStatement() {
 }
 
 Parser::ASTNode *Parser::parseDeclareStatement() {
-    auto *node = new ASTNode;
+    auto *node = newNode();
     node->type = VAR_DECLARE_NODE;
     Lexer::Token token = getToken();
-    if (token.value == ";") {
+    if (token.kind == Lexer::SEMICOLON) {
         node->type = NONE;
         return node;
     }
-    assert(token.value == "var" || token.value == "let" || token.value == "const");
+    assert(token.kind == Lexer::KW_VAR || token.kind == Lexer::KW_LET || token.kind == Lexer::KW_CONST);
+    node->isConst = token.kind == Lexer::KW_CONST;
     token = getToken();
     assert(token.type == Lexer::ID);
-    node->token = token;
+    setToken(node, token);
     token = getToken();
-    assert(token.value == "=");
+    assert(token.kind == Lexer::ASSIGN);
     node->child[0] = parseExpression();
     token = getToken();
-    if (token.value != ";") restoreToken();
+    if (token.kind != Lexer::SEMICOLON) restoreToken();
     return node;
 }
 
 Parser::ASTNode *Parser::parseParameterList() {
-    auto *node = new ASTNode;
+    auto *node = newNode();
     auto *parent = node;
     Lexer::Token token = getToken();
     while (token.type == Lexer::ID) {
-        node->token = token;
+        setToken(node, token);
         node->type = ARGUMENT_NODE;
         token = getToken();
-        if (token.value == ",") {
+        if (token.kind == Lexer::COMMA) {
             token = getToken();
-            node->next = new ASTNode;
+            node->next = newNode();
             node = node->next;
             continue;
         } else {
-            assert(token.value == ")");
+            assert(token.kind == Lexer::RIGHT_PAREN);
             restoreToken();
             break;
         }
@@ -195,47 +273,48 @@ Parser::ASTNode *Parser::parseParameterList() {
 }
 
 Parser::ASTNode *Parser::parseAssignStatement() {
-    auto *node = new ASTNode;
+    auto *node = newNode();
     node->type = VAR_ASSIGN_NODE;
     Lexer::Token token = getToken();
     assert(token.type == Lexer::ID);
-    node->token = token;
+    setToken(node, token);
     token = getToken();
-    if (token.value == "[") {
+    if (token.kind == Lexer::LEFT_BRACKET) {
         node->child[1] = parseExpression();
         token = getToken();
-        assert(token.value == "]");
+        assert(token.kind == Lexer::RIGHT_BRACKET);
         token = getToken();
     }
-    assert(token.value == "=");
+    assert(token.kind == Lexer::ASSIGN);
     node->child[0] = parseExpression();
     token = getToken();
-    if (token.value != ";") restoreToken();
+    if (token.kind != Lexer::SEMICOLON) restoreToken();
     return node;
 }
 
 Parser::ASTNode *Parser::parseIfStatement() {
-    auto *node = new ASTNode;
+    auto *node = newNode();
     node->type = IF_NODE;
     Lexer::Token token = getToken();
-    assert(token.value == "if");
+    assert(token.kind == Lexer::KW_IF);
+    node->rowNumber = token.rowNumber;
     token = getToken();
-    assert(token.value == "(");
+    assert(token.kind == Lexer::LEFT_PAREN);
     node->child[0] = parseExpression();
     token = getToken();
-    assert(token.value == ")");
+    assert(token.kind == Lexer::RIGHT_PAREN);
     token = getToken();
-    assert(token.value == "{");
+    assert(token.kind == Lexer::LEFT_BRACE);
     node->child[1] = parseStatementList();
     token = getToken();
-    assert(token.value == "}");
+    assert(token.kind == Lexer::RIGHT_BRACE);
     token = getToken();
-    if (token.value == "else") {
+    if (token.kind == Lexer::KW_ELSE) {
         token = getToken();
-        assert(token.value == "{");
+        assert(token.kind == Lexer::LEFT_BRACE);
         node->child[2] = parseStatementList();
         token = getToken();
-        assert(token.value == "}");
+        assert(token.kind == Lexer::RIGHT_BRACE);
     } else {
         restoreToken();
     }
@@ -243,73 +322,96 @@ Parser::ASTNode *Parser::parseIfStatement() {
 }
 
 Parser::ASTNode *Parser::parseWhileStatement() {
-    auto *node = new ASTNode;
+    auto *node = newNode();
     node->type = WHILE_NODE;
     Lexer::Token token = getToken();
-    assert(token.value == "while");
+    assert(token.kind == Lexer::KW_WHILE);
+    node->rowNumber = token.rowNumber;
     token = getToken();
-    assert(token.value == "(");
+    assert(token.kind == Lexer::LEFT_PAREN);
     node->child[0] = parseExpression();
     token = getToken();
-    assert(token.value == ")");
+    assert(token.kind == Lexer::RIGHT_PAREN);
     token = getToken();
-    assert(token.value == "{");
+    assert(token.kind == Lexer::LEFT_BRACE);
+    loopDepth++;
     node->child[1] = parseStatementList();
+    loopDepth--;
     token = getToken();
-    assert(token.value == "}");
+    assert(token.kind == Lexer::RIGHT_BRACE);
     return node;
 }
 
 Parser::ASTNode *Parser::parseForStatement() {
-    auto *node = new ASTNode;
+    auto *node = newNode();
     node->type = FOR_NODE;
     Lexer::Token token = getToken();
-    assert(token.value == "for");
+    assert(token.kind == Lexer::KW_FOR);
+    node->rowNumber = token.rowNumber;
     token = getToken();
-    assert(token.value == "(");
+    assert(token.kind == Lexer::LEFT_PAREN);
     node->child[0] = parseDeclareStatement();
     node->child[1] = parseExpression();
     token = getToken();
-    assert(token.value == ";");
+    assert(token.kind == Lexer::SEMICOLON);
     node->child[2] = parseAssignStatement();
     token = getToken();
-    assert(token.value == ")");
+    assert(token.kind == Lexer::RIGHT_PAREN);
     token = getToken();
-    assert(token.value == "{");
+    assert(token.kind == Lexer::LEFT_BRACE);
+    loopDepth++;
     node->child[3] = parseStatementList();
+    loopDepth--;
     token = getToken();
-    assert(token.value == "}");
+    assert(token.kind == Lexer::RIGHT_BRACE);
     return node;
 }
 
 Parser::ASTNode *Parser::parseReturnStatement() {
     Lexer::Token token = getToken();
-    assert(token.value == "return");
-    auto *node = new ASTNode;
+    assert(token.kind == Lexer::KW_RETURN);
+    auto *node = newNode();
     node->type = RETURN_NODE;
+    node->rowNumber = token.rowNumber;
     node->child[0] = parseExpression();
     token = getToken();
-    if (token.value != ";") restoreToken();
+    if (token.kind != Lexer::SEMICOLON) restoreToken();
+    return node;
+}
+
+Parser::ASTNode *Parser::parseJumpStatement() {
+    Lexer::Token token = getToken();
+    assert(token.kind == Lexer::KW_BREAK || token.kind == Lexer::KW_CONTINUE);
+    auto *node = newNode();
+    node->type = token.kind == Lexer::KW_BREAK ? BREAK_NODE : CONTINUE_NODE;
+    setToken(node, token);
+    if (loopDepth == 0) {
+        // Dropped, so that every engine runs the rest of the program.
+        error("jump statement outside of a loop", token);
+        node->type = NONE;
+    }
+    token = getToken();
+    if (token.kind != Lexer::SEMICOLON) restoreToken();
     return node;
 }
 
 Parser::ASTNode *Parser::parseCallExpression() {
-    auto *node = new ASTNode;
+    auto *node = newNode();
     node->type = FUNCTION_CALL_NODE;
     Lexer::Token token = getToken();
     assert(token.type == Lexer::ID);
-    node->token = token;
+    setToken(node, token);
     token = getToken();
-    assert(token.value == "(");
+    assert(token.kind == Lexer::LEFT_PAREN);
     node->child[0] = parseArgumentList();
     token = getToken();
-    assert(token.value == ")");
+    assert(token.kind == Lexer::RIGHT_PAREN);
     return node;
 }
 
 Parser::ASTNode *Parser::parseArgumentList() {
     Lexer::Token token = getToken();
-    if (token.value == ")") {
+    if (token.kind == Lexer::RIGHT_PAREN) {
         restoreToken();
         return nullptr;
     }
@@ -317,7 +419,7 @@ Parser::ASTNode *Parser::parseArgumentList() {
     auto *node = parseExpression();
     auto *parent = node;
     token = getToken();
-    while (token.value == ",") {
+    while (token.kind == Lexer::COMMA) {
         node->next = parseExpression();
         node = node->next;
         token = getToken();
@@ -330,7 +432,7 @@ Parser::ASTNode *Parser::parseFactorList() {
     auto *node = parseFactor();
     auto *parent = node;
     auto token = getToken();
-    while (token.value == ",") {
+    while (token.kind == Lexer::COMMA) {
         node->next = parseFactor();
         node = node->next;
         token = getToken();
@@ -342,24 +444,24 @@ Parser::ASTNode *Parser::parseFactorList() {
 Parser::ASTNode *Parser::parseExpression() {
     Lexer::Token token = getToken();
     restoreToken();
-    if (token.value == "[") {
+    if (token.kind == Lexer::LEFT_BRACKET) {
         return parseArrayDeclareExpression();
     }
     auto *node = parseAdditiveExpression();
     token = getToken();
-    if (token.value == "<=" || token.value == ">=" || token.value == "==" ||
-        token.value == "<" || token.value == ">" || token.value == "!=" ||
-        token.value == "&&" || token.value == "||") {
-        auto *parent = new ASTNode;
+    Operator op = relationalOperator(token.kind);
+    if (op != OP_NONE) {
+        auto *parent = newNode();
         parent->type = BINARY_OPERATOR_NODE;
-        parent->token = token;
+        setToken(parent, token);
+        parent->op = op;
         parent->child[0] = node;
         parent->child[1] = parseAdditiveExpression();
         node = parent;
     } else {
         restoreToken();
     }
-    auto *result = new ASTNode;
+    auto *result = newNode();
     result->type = EXPRESSION_NODE;
     result->child[0] = node;
     return result;
@@ -368,10 +470,11 @@ Parser::ASTNode *Parser::parseExpression() {
 Parser::ASTNode *Parser::parseAdditiveExpression() {
     ASTNode *node = parseTerm();
     Lexer::Token token = getToken();
-    while (token.value == "+" || token.value == "-") {
-        auto *parent = new ASTNode;
+    while (token.kind == Lexer::PLUS || token.kind == Lexer::MINUS) {
+        auto *parent = newNode();
         parent->type = BINARY_OPERATOR_NODE;
-        parent->token = token;
+        setToken(parent, token);
+        parent->op = token.kind == Lexer::PLUS ? OP_ADD : OP_SUB;
         parent->child[0] = node;
         parent->child[1] = parseTerm();
         node = parent;
@@ -384,10 +487,11 @@ Parser::ASTNode *Parser::parseAdditiveExpression() {
 Parser::ASTNode *Parser::parseTerm() {
     ASTNode *node = parseFactor();
     Lexer::Token token = getToken();
-    while (token.value == "*" || token.value == "/" || token.value == "%") {
-        auto *parentNode = new ASTNode;
+    while (token.kind == Lexer::STAR || token.kind == Lexer::SLASH || token.kind == Lexer::PERCENT) {
+        auto *parentNode = newNode();
         parentNode->type = BINARY_OPERATOR_NODE;
-        parentNode->token = token;
+        setToken(parentNode, token);
+        parentNode->op = token.kind == Lexer::STAR ? OP_MUL : token.kind == Lexer::SLASH ? OP_DIV : OP_MOD;
         parentNode->child[0] = node;
         node = parentNode;
         parentNode->child[1] = parseFactor();
@@ -399,9 +503,9 @@ Parser::ASTNode *Parser::parseTerm() {
 
 Parser::ASTNode *Parser::parseFactor() {
     Lexer::Token token = getToken();
-    if (token.value == "-") {
-        auto *node = new ASTNode;
-        node->token = token;
+    if (token.kind == Lexer::MINUS) {
+        auto *node = newNode();
+        setToken(node, token);
         node->child[0] = parsePositiveFactor();
         node->type = NEGATIVE_NODE;
         return node;
@@ -414,39 +518,46 @@ Parser::ASTNode *Parser::parseFactor() {
 Parser::ASTNode *Parser::parsePositiveFactor() {
     ASTNode *node = nullptr;
     Lexer::Token token = getToken();
-    if (token.value == "(") {
+    if (token.kind == Lexer::LEFT_PAREN) {
         node = parseExpression();
         token = getToken();
-        if (token.value != ")") {
+        if (token.kind != Lexer::RIGHT_PAREN) {
             error("expect ) but get ", token);
         }
     } else if (token.type == Lexer::INT) {
-        node = new ASTNode;
-        node->token = token;
+        node = newNode();
+        setToken(node, token);
         node->type = INT_NODE;
+        errno = 0;
+        long long i = strtoll(node->text, nullptr, 10);
+        node->value = errno == ERANGE ? Value::real(strtod(node->text, nullptr)) : Value::integer(i);
     } else if (token.type == Lexer::REAL) {
-        node = new ASTNode;
-        node->token = token;
+        node = newNode();
+        setToken(node, token);
         node->type = REAL_NODE;
+        node->value = Value::real(strtod(node->text, nullptr));
     } else if (token.type == Lexer::STRING) {
-        node = new ASTNode;
-        node->token = token;
+        node = newNode();
+        setToken(node, token);
         node->type = STRING_NODE;
+        node->value = Value::string(string(token.value));
     } else if (token.type == Lexer::CHAR) {
-        node = new ASTNode;
-        node->token = token;
+        node = newNode();
+        setToken(node, token);
         node->type = CHAR_NODE;
-    } else if (token.value == "true" || token.value == "false") {
-        node = new ASTNode;
-        node->token = token;
+        node->value = Value::string(string(token.value));
+    } else if (token.kind == Lexer::KW_TRUE || token.kind == Lexer::KW_FALSE) {
+        node = newNode();
+        setToken(node, token);
         node->type = BOOL_NODE;
+        node->value = Value::boolean(token.kind == Lexer::KW_TRUE);
     } else if (token.type == Lexer::ID) {
         token = getToken();
-        if (token.value == "(") {
+        if (token.kind == Lexer::LEFT_PAREN) {
             restoreToken();
             restoreToken();
             node = parseCallExpression();
-        } else if (token.value == "[") {
+        } else if (token.kind == Lexer::LEFT_BRACKET) {
             restoreToken();
             restoreToken();
             node = parseArrayAccessExpression();
@@ -454,8 +565,8 @@ Parser::ASTNode *Parser::parsePositiveFactor() {
             restoreToken();
             restoreToken();
             token = getToken();
-            node = new ASTNode;
-            node->token = token;
+            node = newNode();
+            setToken(node, token);
             node->type = VAR_NODE;
         }
     } else {
@@ -465,51 +576,54 @@ Parser::ASTNode *Parser::parsePositiveFactor() {
 }
 
 Parser::ASTNode *Parser::parseFunction() {
-    auto *node = new ASTNode;
+    auto *node = newNode();
     node->type = FUNCTION_DECLARE_NODE;
     Lexer::Token token = getToken();
-    assert(token.value == "function");
+    assert(token.kind == Lexer::KW_FUNCTION);
     token = getToken();
     assert(token.type == Lexer::ID);
-    node->token = token;
+    setToken(node, token);
     token = getToken();
-    assert(token.value == "(");
+    assert(token.kind == Lexer::LEFT_PAREN);
     token = getToken();
-    if (token.value != ")") {
+    if (token.kind != Lexer::RIGHT_PAREN) {
         restoreToken();
         node->child[0] = parseParameterList();
         token = getToken();
-        assert(token.value == ")");
+        assert(token.kind == Lexer::RIGHT_PAREN);
     }
     token = getToken();
-    assert(token.value == "{");
+    assert(token.kind == Lexer::LEFT_BRACE);
+    int outerLoops = loopDepth; // A jump can't leave the function.
+    loopDepth = 0;
     node->child[1] = parseStatementList();
+    loopDepth = outerLoops;
     token = getToken();
-    assert(token.value == "}");
+    assert(token.kind == Lexer::RIGHT_BRACE);
     return node;
 }
 
 Parser::ASTNode *Parser::parseArrayDeclareExpression() {
-    auto *node = new ASTNode;
+    auto *node = newNode();
     node->type = ARRAY_DECLARE_NODE;
     Lexer::Token token = getToken();
-    assert(token.value == "[");
+    assert(token.kind == Lexer::LEFT_BRACKET);
     node->child[0] = parseFactorList();
     token = getToken();
-    assert(token.value == "]");
+    assert(token.kind == Lexer::RIGHT_BRACKET);
     return node;
 }
 
 Parser::ASTNode *Parser::parseArrayAccessExpression() {
-    auto *node = new ASTNode;
+    auto *node = newNode();
     node->type = ARRAY_ACCESS_NODE;
     Lexer::Token token = getToken();
     assert(token.type == Lexer::ID);
-    node->token = token;
+    setToken(node, token);
     token = getToken();
-    assert(token.value == "[");
+    assert(token.kind == Lexer::LEFT_BRACKET);
     node->child[0] = parseExpression();
     token = getToken();
-    assert(token.value == "]");
+    assert(token.kind == Lexer::RIGHT_BRACKET);
     return node;
 }
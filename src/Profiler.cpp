@@ -0,0 +1,127 @@
+#include "Profiler.h"
+#include <atomic>
+#include <fstream>
+#include <sys/time.h>
+
+using namespace std;
+
+static const long SAMPLE_INTERVAL = 1000; // Microseconds of CPU time.
+static const char *PROGRAM_NAME = "(program)"; // Frame of the top level code.
+
+Profiler *Profiler::active = nullptr;
+
+Profiler::Profiler() {
+    stack = new Entry[MAX_DEPTH];
+    buffer = new Entry[BUFFER_SIZE];
+    stack[0] = {PROGRAM_NAME, 0};
+    depth = 1;
+}
+
+Profiler::~Profiler() {
+    stop();
+    delete[] stack;
+    delete[] buffer;
+}
+
+void Profiler::start() {
+    if (running) return;
+    running = true;
+    active = this;
+    struct sigaction action = {};
+    action.sa_handler = handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, nullptr);
+    itimerval timer = {{0, SAMPLE_INTERVAL}, {0, SAMPLE_INTERVAL}};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+void Profiler::stop() {
+    if (!running) return;
+    itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    signal(SIGPROF, SIG_IGN);
+    running = false;
+    active = nullptr;
+    drain();
+}
+
+// The entry is complete before depth counts it, so a sample never sees a half written frame.
+void Profiler::enter(const char *name, unsigned row) {
+    if (depth < MAX_DEPTH) stack[depth] = {name, row};
+    atomic_signal_fence(memory_order_release);
+    depth = depth + 1;
+    if (used > (sig_atomic_t) BUFFER_SIZE / 2) drain();
+}
+
+void Profiler::leave() {
+    depth = depth - 1;
+}
+
+void Profiler::replace(const char *name, unsigned row) {
+    if (depth > 0 && depth <= MAX_DEPTH) {
+        depth = depth - 1;
+        atomic_signal_fence(memory_order_release);
+        enter(name, row);
+    }
+}
+
+void Profiler::handler(int) {
+    if (active != nullptr) active->sample();
+}
+
+// Runs in the signal handler: copies the stack to the end of the buffer, or drops the
+// sample if it does not fit.
+void Profiler::sample() {
+    size_t frames = depth < MAX_DEPTH ? depth : MAX_DEPTH;
+    if (used + frames + 1 > BUFFER_SIZE) {
+        dropped = dropped + 1;
+        return;
+    }
+    Entry *out = buffer + used;
+    *out++ = {nullptr, (unsigned) frames};
+    for (size_t i = 0; i < frames; ++i) *out++ = stack[i];
+    used = used + (sig_atomic_t) (frames + 1);
+}
+
+// Fold the buffered samples into stack lines. SIGPROF is blocked meanwhile, so the
+// handler cannot append to the buffer while it is being read and emptied.
+void Profiler::drain() {
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGPROF);
+    sigprocmask(SIG_BLOCK, &blocked, &previous);
+    string line;
+    for (size_t i = 0; i < (size_t) used;) {
+        size_t frames = buffer[i++].row;
+        line.clear();
+        for (size_t j = 0; j < frames; ++j, ++i) {
+            if (j > 0) line += ';';
+            line += buffer[i].name;
+            if (buffer[i].row > 0) {
+                line += ':';
+                line += to_string(buffer[i].row);
+            }
+        }
+        folded[line]++;
+        samples++;
+    }
+    used = 0;
+    sigprocmask(SIG_SETMASK, &previous, nullptr);
+}
+
+bool Profiler::write(const string &filename) {
+    ofstream out(filename);
+    for (const auto &stackCount : folded) {
+        out << stackCount.first << ' ' << stackCount.second << '\n';
+    }
+    return (bool) out;
+}
+
+size_t Profiler::getSampleCount() const {
+    return samples;
+}
+
+size_t Profiler::getDroppedCount() const {
+    return dropped;
+}
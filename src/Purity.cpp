@@ -0,0 +1,129 @@
+#include "Purity.h"
+#include <iostream>
+
+using namespace std;
+
+vector<Parser::ASTNode *> Purity::analyze(Parser::ASTNode *root) {
+    functions.clear();
+    functionIndex.clear();
+    collectFunctions(root);
+    for (auto &function : functions) {
+        analyzeList(function, function.declaration->child[1], 1);
+    }
+    // A call to an impure or unknown function makes the caller impure, until nothing changes.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &function : functions) {
+            if (!function.isPure) continue;
+            for (auto callee : function.callees) {
+                auto iter = functionIndex.find(callee);
+                if (iter == functionIndex.end() || iter->second < 0 || !functions[iter->second].isPure) {
+                    function.isPure = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+    vector<Parser::ASTNode *> result;
+    for (auto &function : functions) {
+        if (function.isPure) {
+            log("pure function: ", function.declaration->text);
+            result.push_back(function.declaration);
+        }
+    }
+    return result;
+}
+
+void Purity::setDebugMode(bool enable) {
+    debug = enable;
+}
+
+void Purity::log(const string &message, const std::string &extra) {
+    if (!debug) return;
+    cout << "[Purity] [Log]: " << message << extra << endl;
+}
+
+void Purity::collectFunctions(Parser::ASTNode *node) {
+    for (; node != nullptr; node = node->next) {
+        if (node->type == Parser::FUNCTION_DECLARE_NODE) {
+            auto iter = functionIndex.find(node->atom);
+            if (iter == functionIndex.end()) {
+                functionIndex[node->atom] = (int) functions.size();
+                functions.emplace_back();
+                functions.back().declaration = node;
+            } else if (iter->second >= 0) {
+                // Which declaration a call reaches depends on execution order.
+                functions[iter->second].isPure = false;
+                iter->second = -1;
+            }
+        }
+        for (auto *child : node->child) {
+            collectFunctions(child);
+        }
+    }
+}
+
+void Purity::analyzeList(Function &function, Parser::ASTNode *node, int open) {
+    for (; node != nullptr && function.isPure; node = node->next) {
+        analyzeNode(function, node, open);
+    }
+}
+
+// open is the number of frames of the function around the node, resolved depths below it
+// are local. Loop scopes of size 0 were elided by the resolver and have no frame.
+void Purity::analyzeNode(Function &function, Parser::ASTNode *node, int open) {
+    if (node == nullptr || !function.isPure) return;
+    switch (node->type) {
+        case Parser::VAR_NODE:
+            if (node->depth >= open) function.isPure = false;
+            break;
+        case Parser::ARRAY_ACCESS_NODE:
+            if (node->depth >= open) function.isPure = false;
+            analyzeNode(function, node->child[0], open);
+            break;
+        case Parser::VAR_ASSIGN_NODE:
+            if (node->depth >= open || node->child[1] != nullptr) function.isPure = false;
+            analyzeNode(function, node->child[0], open);
+            break;
+        case Parser::FUNCTION_CALL_NODE:
+            if (node->atom == AtomTable::INPUT || node->atom == AtomTable::OUTPUT) {
+                function.isPure = false;
+            } else {
+                function.callees.insert(node->atom);
+                analyzeList(function, node->child[0], open);
+            }
+            break;
+        case Parser::FUNCTION_DECLARE_NODE:
+            function.isPure = false; // Declaring changes the function table.
+            break;
+        case Parser::ARRAY_DECLARE_NODE:
+            analyzeList(function, node->child[0], open);
+            break;
+        case Parser::IF_NODE:
+            analyzeNode(function, node->child[0], open);
+            analyzeList(function, node->child[1], open);
+            analyzeList(function, node->child[2], open);
+            break;
+        case Parser::WHILE_NODE: {
+            int header = open + (node->scopeSize > 0);
+            analyzeNode(function, node->child[0], header);
+            analyzeList(function, node->child[1], header + (node->bodyScopeSize > 0));
+            break;
+        }
+        case Parser::FOR_NODE: {
+            int header = open + (node->scopeSize > 0);
+            analyzeNode(function, node->child[0], header);
+            analyzeNode(function, node->child[1], header);
+            analyzeNode(function, node->child[2], header);
+            analyzeList(function, node->child[3], header + (node->bodyScopeSize > 0));
+            break;
+        }
+        default:
+            for (auto *child : node->child) {
+                analyzeNode(function, child, open);
+            }
+            break;
+    }
+}
@@ -0,0 +1,185 @@
+#include "Resolver.h"
+#include <iostream>
+#include <cassert>
+
+using namespace std;
+
+Resolver::Resolver() {
+    scopes.emplace_back();
+}
+
+void Resolver::resolve(Parser::ASTNode *node) {
+    assert(scopes.size() == 1);
+    resolveList(node);
+}
+
+int Resolver::getGlobalCount() const {
+    return scopes[0].size;
+}
+
+const map<string, int> &Resolver::getGlobals() const {
+    return declaredGlobals;
+}
+
+void Resolver::setDebugMode(bool enable) {
+    debug = enable;
+}
+
+void Resolver::log(const string &message, const std::string &extra) {
+    if (!debug) return;
+    cout << "[Resolver] [Log]: " << message << extra << endl;
+}
+
+void Resolver::enterScope(bool isFunction, bool isElided) {
+    scopes.emplace_back();
+    scopes.back().isFunction = isFunction;
+    scopes.back().isElided = isElided;
+}
+
+// Whether a statement list declares variables in its own scope. If statements share
+// the scope of the enclosing block, so declarations in their branches count too.
+bool Resolver::declaresVariables(Parser::ASTNode *node) {
+    for (; node != nullptr; node = node->next) {
+        if (node->type == Parser::VAR_DECLARE_NODE) return true;
+        if (node->type == Parser::IF_NODE &&
+            (declaresVariables(node->child[1]) || declaresVariables(node->child[2]))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Resolver::isInFunction() const {
+    for (const auto &scope : scopes) {
+        if (scope.isFunction) return true;
+    }
+    return false;
+}
+
+// A return of such a call ends the function, so the callee can take over the caller's frame.
+bool Resolver::isUserCall(Parser::ASTNode *node) {
+    if (node != nullptr && node->type == Parser::EXPRESSION_NODE) node = node->child[0];
+    return node != nullptr && node->type == Parser::FUNCTION_CALL_NODE &&
+           node->atom != AtomTable::INPUT && node->atom != AtomTable::OUTPUT;
+}
+
+// Close the innermost scope and return the size of its frame.
+int Resolver::exitScope() {
+    int size = scopes.back().size;
+    scopes.pop_back();
+    return size;
+}
+
+// Give the declared name a slot in the innermost scope. A redeclaration reuses the slot.
+void Resolver::declare(Parser::ASTNode *node) {
+    Scope &scope = scopes.back();
+    assert(!scope.isElided);
+    auto iter = scope.names.find(node->atom);
+    if (iter == scope.names.end()) {
+        iter = scope.names.insert({node->atom, scope.size++}).first;
+    }
+    node->depth = 0;
+    node->slot = iter->second;
+    if (scopes.size() == 1) declaredGlobals[AtomTable::name(node->atom)] = iter->second;
+}
+
+// Find the frame holding the referenced name. Functions only see their own scopes and
+// the global scope, since a function frame is linked directly to the global frame.
+// Elided scopes have no frame and are not counted. Names that are not found anywhere
+// become globals.
+void Resolver::lookup(Parser::ASTNode *node) {
+    int depth = 0;
+    for (int i = (int) scopes.size() - 1; i > 0; --i) {
+        auto iter = scopes[i].names.find(node->atom);
+        if (iter != scopes[i].names.end()) {
+            node->depth = depth;
+            node->slot = iter->second;
+            return;
+        }
+        if (!scopes[i].isElided) depth++;
+        if (scopes[i].isFunction) break;
+    }
+    Scope &global = scopes[0];
+    auto iter = global.names.find(node->atom);
+    if (iter == global.names.end()) {
+        log("use undeclared variable: ", node->text);
+        iter = global.names.insert({node->atom, global.size++}).first;
+    }
+    node->depth = depth;
+    node->slot = iter->second;
+}
+
+void Resolver::resolveList(Parser::ASTNode *node) {
+    while (node != nullptr) {
+        resolveNode(node);
+        node = node->next;
+    }
+}
+
+void Resolver::resolveNode(Parser::ASTNode *node) {
+    if (node == nullptr) return;
+    switch (node->type) {
+        case Parser::VAR_DECLARE_NODE:
+            resolveNode(node->child[0]);
+            declare(node);
+            break;
+        case Parser::VAR_ASSIGN_NODE:
+            resolveNode(node->child[1]);
+            resolveNode(node->child[0]);
+            lookup(node);
+            break;
+        case Parser::VAR_NODE:
+            lookup(node);
+            break;
+        case Parser::ARRAY_ACCESS_NODE:
+            resolveNode(node->child[0]);
+            lookup(node);
+            break;
+        case Parser::ARRAY_DECLARE_NODE:
+            resolveList(node->child[0]);
+            break;
+        case Parser::FUNCTION_CALL_NODE:
+            resolveList(node->child[0]);
+            break;
+        case Parser::IF_NODE:
+            resolveNode(node->child[0]);
+            resolveList(node->child[1]);
+            resolveList(node->child[2]);
+            break;
+        case Parser::WHILE_NODE:
+            enterScope(false, true); // The header of a while loop never declares anything.
+            resolveNode(node->child[0]);
+            enterScope(false, !declaresVariables(node->child[1]));
+            resolveList(node->child[1]);
+            node->bodyScopeSize = exitScope();
+            node->scopeSize = exitScope();
+            break;
+        case Parser::FOR_NODE:
+            enterScope(false, !declaresVariables(node->child[0]));
+            resolveNode(node->child[0]); // Initialization
+            resolveNode(node->child[1]); // Condition
+            resolveNode(node->child[2]); // Update
+            enterScope(false, !declaresVariables(node->child[3]));
+            resolveList(node->child[3]); // Body
+            node->bodyScopeSize = exitScope();
+            node->scopeSize = exitScope();
+            break;
+        case Parser::FUNCTION_DECLARE_NODE:
+            enterScope(true, false);
+            for (auto *argument = node->child[0]; argument != nullptr; argument = argument->next) {
+                declare(argument);
+            }
+            resolveList(node->child[1]);
+            node->scopeSize = exitScope();
+            break;
+        case Parser::RETURN_NODE:
+            resolveNode(node->child[0]);
+            node->isTailCall = isInFunction() && isUserCall(node->child[0]);
+            break;
+        default:
+            for (auto *child : node->child) {
+                resolveNode(child);
+            }
+            break;
+    }
+}
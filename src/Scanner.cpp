@@ -0,0 +1,189 @@
+#include "Scanner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCANNER_X86
+#endif
+
+static Scanner::Mode bestMode() {
+#ifdef SCANNER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Scanner::AVX2;
+    if (__builtin_cpu_supports("sse2")) return Scanner::SSE2;
+#endif
+    return Scanner::SCALAR;
+}
+
+Scanner::Mode Scanner::mode = bestMode();
+
+Scanner::Mode Scanner::getMode() {
+    return mode;
+}
+
+void Scanner::setMode(Mode m) {
+    Mode best = bestMode();
+    mode = m > best ? best : m;
+}
+
+const char *Scanner::modeName(Mode m) {
+    switch (m) {
+        case AVX2:
+            return "avx2";
+        case SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+static const char *skipSpaceScalar(const char *p, const char *end, unsigned &newlines) {
+    while (p < end && Scanner::is(*p, Scanner::SPACE)) {
+        if (*p == '\n') newlines++;
+        p++;
+    }
+    return p;
+}
+
+static const char *skipClassScalar(const char *p, const char *end, unsigned char classes) {
+    while (p < end && Scanner::is(*p, classes)) p++;
+    return p;
+}
+
+#ifdef SCANNER_X86
+
+// The vector versions build a bit mask of the characters in the run, one bit per
+// byte. The first zero bit is where the run ends. Bytes above 0x7f compare as
+// negative and never match. Only whole vectors inside [p, end) are loaded, the tail
+// goes through the scalar loop.
+
+static inline __m128i inRange16(__m128i v, char low, char high) {
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8((char) (low - 1))),
+                         _mm_cmplt_epi8(v, _mm_set1_epi8((char) (high + 1))));
+}
+
+static inline unsigned spaceMask16(__m128i v) {
+    __m128i space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), inRange16(v, '\t', '\r'));
+    return (unsigned) _mm_movemask_epi8(space);
+}
+
+static inline unsigned digitMask16(__m128i v) {
+    return (unsigned) _mm_movemask_epi8(inRange16(v, '0', '9'));
+}
+
+static inline unsigned identifierMask16(__m128i v) {
+    __m128i letter = inRange16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i other = _mm_or_si128(inRange16(v, '0', '9'), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    return (unsigned) _mm_movemask_epi8(_mm_or_si128(letter, other));
+}
+
+static const char *skipSpaceSSE2(const char *p, const char *end, unsigned &newlines) {
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        unsigned run = spaceMask16(v);
+        unsigned lines = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        if (run != 0xffff) {
+            int length = __builtin_ctz(~run);
+            newlines += __builtin_popcount(lines & ((1u << length) - 1));
+            return p + length;
+        }
+        newlines += __builtin_popcount(lines);
+    }
+    return skipSpaceScalar(p, end, newlines);
+}
+
+template<unsigned (*mask)(__m128i)>
+static const char *skipRunSSE2(const char *p, const char *end, unsigned char classes) {
+    for (; end - p >= 16; p += 16) {
+        unsigned run = mask(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        if (run != 0xffff) return p + __builtin_ctz(~run);
+    }
+    return skipClassScalar(p, end, classes);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i inRange32(__m256i v, char low, char high) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8((char) (low - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8((char) (high + 1)), v));
+}
+
+__attribute__((target("avx2")))
+static inline unsigned spaceMask32(__m256i v) {
+    __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), inRange32(v, '\t', '\r'));
+    return (unsigned) _mm256_movemask_epi8(space);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned digitMask32(__m256i v) {
+    return (unsigned) _mm256_movemask_epi8(inRange32(v, '0', '9'));
+}
+
+__attribute__((target("avx2")))
+static inline unsigned identifierMask32(__m256i v) {
+    __m256i letter = inRange32(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+    __m256i other = _mm256_or_si256(inRange32(v, '0', '9'), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+    return (unsigned) _mm256_movemask_epi8(_mm256_or_si256(letter, other));
+}
+
+__attribute__((target("avx2")))
+static const char *skipSpaceAVX2(const char *p, const char *end, unsigned &newlines) {
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        unsigned run = spaceMask32(v);
+        unsigned lines = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        if (run != 0xffffffffu) {
+            int length = __builtin_ctz(~run);
+            newlines += __builtin_popcount(lines & ((1u << length) - 1));
+            return p + length;
+        }
+        newlines += __builtin_popcount(lines);
+    }
+    return skipSpaceSSE2(p, end, newlines);
+}
+
+template<unsigned (*mask32)(__m256i), unsigned (*mask16)(__m128i)>
+__attribute__((target("avx2")))
+static const char *skipRunAVX2(const char *p, const char *end, unsigned char classes) {
+    for (; end - p >= 32; p += 32) {
+        unsigned run = mask32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+        if (run != 0xffffffffu) return p + __builtin_ctz(~run);
+    }
+    return skipRunSSE2<mask16>(p, end, classes);
+}
+
+#endif
+
+// Most runs are a few characters long, a vector only pays off after a short scalar prefix.
+static const int SCALAR_PREFIX = 8;
+
+const char *Scanner::skipSpace(const char *p, const char *end, unsigned &newlines) {
+    const char *prefixEnd = end - p > SCALAR_PREFIX ? p + SCALAR_PREFIX : end;
+    p = skipSpaceScalar(p, prefixEnd, newlines);
+    if (p < prefixEnd) return p;
+#ifdef SCANNER_X86
+    if (mode == AVX2) return skipSpaceAVX2(p, end, newlines);
+    if (mode == SSE2) return skipSpaceSSE2(p, end, newlines);
+#endif
+    return skipSpaceScalar(p, end, newlines);
+}
+
+const char *Scanner::skipIdentifier(const char *p, const char *end) {
+    const char *prefixEnd = end - p > SCALAR_PREFIX ? p + SCALAR_PREFIX : end;
+    p = skipClassScalar(p, prefixEnd, IDENTIFIER);
+    if (p < prefixEnd) return p;
+#ifdef SCANNER_X86
+    if (mode == AVX2) return skipRunAVX2<identifierMask32, identifierMask16>(p, end, IDENTIFIER);
+    if (mode == SSE2) return skipRunSSE2<identifierMask16>(p, end, IDENTIFIER);
+#endif
+    return skipClassScalar(p, end, IDENTIFIER);
+}
+
+const char *Scanner::skipDigits(const char *p, const char *end) {
+    const char *prefixEnd = end - p > SCALAR_PREFIX ? p + SCALAR_PREFIX : end;
+    p = skipClassScalar(p, prefixEnd, DIGIT);
+    if (p < prefixEnd) return p;
+#ifdef SCANNER_X86
+    if (mode == AVX2) return skipRunAVX2<digitMask32, digitMask16>(p, end, DIGIT);
+    if (mode == SSE2) return skipRunSSE2<digitMask16>(p, end, DIGIT);
+#endif
+    return skipClassScalar(p, end, DIGIT);
+}
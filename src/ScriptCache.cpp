@@ -0,0 +1,282 @@
+#include "ScriptCache.h"
+#include "MappedFile.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char MAGIC[8] = {'J', 'S', 'A', 'S', 'T', '\0', '\0', '\0'};
+static const uint32_t FORMAT_VERSION = 3;
+static const uint32_t NO_NODE = 0xffffffffu;
+static const uint8_t HAS_ATOM = 1;
+static const uint8_t IS_CONST = 2;
+
+namespace {
+class Header {
+public:
+    char magic[8];
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t stringCount; // Distinct node texts.
+    uint32_t padding;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint64_t poolSize; // Bytes of NUL-terminated texts, after the nodes and the string offsets.
+};
+
+// A node with its pointers turned into indices and its text into a pool offset.
+class NodeRecord {
+public:
+    uint8_t type;
+    uint8_t op;
+    uint8_t valueType;
+    uint8_t flags;
+    uint32_t rowNumber;
+    uint32_t text; // Index of the node's text in the string table.
+    uint32_t child[4];
+    uint32_t next;
+    union {
+        int64_t i;
+        double d;
+        uint8_t b;
+    } value; // STRING values are the node's text.
+};
+}
+
+ScriptCache::ScriptCache(const string &directory) : directory(directory) {}
+
+void ScriptCache::setDebugMode(bool enable) {
+    debug = enable;
+}
+
+void ScriptCache::log(const string &message, const std::string &extra) {
+    if (!debug) return;
+    cout << "[ScriptCache] [Log]: " << message << extra << endl;
+}
+
+// FNV-1a.
+uint64_t ScriptCache::hash(const char *data, size_t size) {
+    uint64_t result = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        result ^= (unsigned char) data[i];
+        result *= 1099511628211ull;
+    }
+    return result;
+}
+
+string ScriptCache::entryPath(uint64_t sourceHash) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.ast", (unsigned long long) sourceHash);
+    return directory + "/" + name;
+}
+
+void ScriptCache::parseFile(const string &filename, Parser &parser) {
+    string name = filename;
+    MappedFile source;
+    if (!source.open(filename)) {
+        parser.parseFile(name); // Reports the error.
+        return;
+    }
+    uint64_t sourceHash = hash(source.data(), source.size());
+    string path = entryPath(sourceHash);
+    if (load(path, sourceHash, source.size(), parser)) {
+        log("hit: ", path);
+        return;
+    }
+    parser.parseFile(name);
+    store(path, sourceHash, source.size(), parser.getAST());
+}
+
+bool ScriptCache::load(const string &path, uint64_t sourceHash, uint64_t sourceSize, Parser &parser) {
+    MappedFile entry;
+    if (!entry.open(path)) {
+        log("miss: ", path);
+        return false;
+    }
+    const char *data = entry.data();
+    size_t size = entry.size();
+    Header header;
+    if (size < sizeof(Header)) {
+        log("stale entry, rebuilding: ", path);
+        return false;
+    }
+    memcpy(&header, data, sizeof(Header));
+    size_t offsetsStart = sizeof(Header) + (size_t) header.nodeCount * sizeof(NodeRecord);
+    size_t poolStart = offsetsStart + (size_t) header.stringCount * sizeof(uint32_t);
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION ||
+        header.sourceHash != sourceHash || header.sourceSize != sourceSize ||
+        poolStart > size || size - poolStart != header.poolSize ||
+        (header.poolSize > 0 && data[size - 1] != '\0')) {
+        log("stale entry, rebuilding: ", path);
+        return false;
+    }
+    const auto *records = reinterpret_cast<const NodeRecord *>(data + sizeof(Header));
+    const auto *offsets = reinterpret_cast<const uint32_t *>(data + offsetsStart);
+    // Validate everything before touching the parser, a bad entry is simply rebuilt.
+    bool valid = true;
+    for (uint32_t i = 0; i < header.stringCount; ++i) {
+        valid = valid && offsets[i] < header.poolSize;
+    }
+    // The links must form a tree: store numbers nodes in the order it reaches them, so
+    // each one is linked once, from an earlier node. Anything else may be a cycle.
+    vector<bool> linked(header.nodeCount, false);
+    auto link = [&](uint32_t from, uint32_t to) {
+        if (to == NO_NODE) return true;
+        if (to <= from || to >= header.nodeCount || linked[to]) return false;
+        linked[to] = true;
+        return true;
+    };
+    for (uint32_t i = 0; i < header.nodeCount && valid; ++i) {
+        const NodeRecord &record = records[i];
+        valid = record.text < header.stringCount && record.type <= Parser::CONTINUE_NODE &&
+                     record.op <= Parser::OP_OR && record.valueType <= Value::STRING;
+        for (uint32_t child : record.child) valid = valid && link(i, child);
+        valid = valid && link(i, record.next);
+    }
+    if (!valid) {
+        log("stale entry, rebuilding: ", path);
+        return false;
+    }
+    parser.arena->release();
+    // The texts are copied into the arena in one piece, names are interned once each.
+    auto *pool = static_cast<char *>(parser.arena->allocate(header.poolSize, 1));
+    memcpy(pool, data + poolStart, header.poolSize);
+    vector<AtomTable::Atom> atoms(header.stringCount, AtomTable::NO_ATOM);
+    Parser::ASTNode *nodes = parser.arena->makeArray<Parser::ASTNode>(header.nodeCount);
+    for (uint32_t i = 0; i < header.nodeCount; ++i) {
+        const NodeRecord &record = records[i];
+        Parser::ASTNode *node = nodes + i;
+        node->type = (Parser::NodeType) record.type;
+        node->op = (Parser::Operator) record.op;
+        node->rowNumber = record.rowNumber;
+        node->text = pool + offsets[record.text];
+        if (record.flags & HAS_ATOM) {
+            AtomTable::Atom &atom = atoms[record.text];
+            if (atom == AtomTable::NO_ATOM) atom = AtomTable::intern(node->text);
+            node->atom = atom;
+        }
+        node->isConst = (record.flags & IS_CONST) != 0;
+        switch (record.valueType) {
+            case Value::BOOL:
+                node->value = Value::boolean(record.value.b != 0);
+                break;
+            case Value::INT:
+                node->value = Value::integer(record.value.i);
+                break;
+            case Value::REAL:
+                node->value = Value::real(record.value.d);
+                break;
+            case Value::STRING:
+                node->value = Value::string(node->text);
+                break;
+            default:
+                break;
+        }
+        for (int c = 0; c < 4; ++c) {
+            node->child[c] = record.child[c] == NO_NODE ? nullptr : nodes + record.child[c];
+        }
+        node->next = record.next == NO_NODE ? nullptr : nodes + record.next;
+    }
+    parser.root = header.nodeCount > 0 ? nodes : nullptr;
+    return true;
+}
+
+// Written to a temporary file first and renamed, so concurrent runs never see a partial entry.
+void ScriptCache::store(const string &path, uint64_t sourceHash, uint64_t sourceSize, Parser::ASTNode *root) {
+    vector<Parser::ASTNode *> nodes;
+    unordered_map<Parser::ASTNode *, uint32_t> indices;
+    bool isShared = false; // A node linked twice, which load would reject.
+    auto index = [&](Parser::ASTNode *node) -> uint32_t {
+        if (node == nullptr) return NO_NODE;
+        auto iter = indices.find(node);
+        if (iter != indices.end()) {
+            isShared = true;
+            return iter->second;
+        }
+        auto i = (uint32_t) nodes.size();
+        indices[node] = i;
+        nodes.push_back(node);
+        return i;
+    };
+    index(root);
+    vector<NodeRecord> records;
+    vector<uint32_t> offsets;
+    unordered_map<string, uint32_t> strings; // Text to string table index.
+    string pool;
+    for (size_t i = 0; i < nodes.size(); ++i) { // Grows while children are numbered.
+        Parser::ASTNode *node = nodes[i];
+        NodeRecord record{};
+        record.type = (uint8_t) node->type;
+        record.op = (uint8_t) node->op;
+        record.rowNumber = node->rowNumber;
+        record.flags = node->atom != AtomTable::NO_ATOM ? HAS_ATOM : 0;
+        if (node->isConst) record.flags |= IS_CONST;
+        auto text = strings.insert({node->text, (uint32_t) offsets.size()});
+        if (text.second) {
+            offsets.push_back((uint32_t) pool.size());
+            pool.append(node->text);
+            pool.push_back('\0');
+        }
+        record.text = text.first->second;
+        record.valueType = (uint8_t) node->value.getType();
+        switch (node->value.getType()) {
+            case Value::BOOL:
+                record.value.b = node->value.getBool();
+                break;
+            case Value::INT:
+                record.value.i = node->value.getInt();
+                break;
+            case Value::REAL:
+                record.value.d = node->value.getReal();
+                break;
+            case Value::STRING:
+                if (node->value.getString() != node->text) return; // Not representable, skip caching.
+                break;
+            case Value::ARRAY:
+                return;
+            default:
+                break;
+        }
+        for (int c = 0; c < 4; ++c) {
+            record.child[c] = index(node->child[c]);
+        }
+        record.next = index(node->next);
+        records.push_back(record);
+    }
+    if (isShared) return; // Not a tree, skip caching.
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        log("cannot create cache directory: ", directory);
+        return;
+    }
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.nodeCount = (uint32_t) records.size();
+    header.stringCount = (uint32_t) offsets.size();
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.poolSize = pool.size();
+    string temporary = path + "." + to_string(getpid()) + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        log("cannot write cache entry: ", temporary);
+        return;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   (records.empty() || fwrite(records.data(), sizeof(NodeRecord), records.size(), file) == records.size()) &&
+                   (offsets.empty() || fwrite(offsets.data(), sizeof(uint32_t), offsets.size(), file) == offsets.size()) &&
+                   (pool.empty() || fwrite(pool.data(), 1, pool.size(), file) == pool.size());
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        log("cannot write cache entry: ", path);
+        return;
+    }
+    log("stored: ", path);
+}
@@ -0,0 +1,281 @@
+#include "VM.h"
+#include "Collector.h"
+#include "Interpreter.h"
+#include <iostream>
+#include <utility>
+
+using namespace std;
+
+static const size_t STACK_SIZE = 1 << 18; // Values.
+static const int STACK_RESERVE = 1024; // Operand stack room guaranteed to every frame.
+
+// Numeric fast paths skip the generic operators when both operands are numbers.
+static inline bool bothIntegers(const Value &left, const Value &right) {
+    return left.getType() == Value::INT && right.getType() == Value::INT;
+}
+
+static inline bool bothNumbers(const Value &left, const Value &right) {
+    return left.isNumber() && right.isNumber();
+}
+
+static inline double number(const Value &value) {
+    return value.getType() == Value::INT ? (double) value.getInt() : value.getReal();
+}
+
+VM::VM(Interpreter &interpreter) : interpreter(interpreter) {}
+
+void VM::error(const string &message, const std::string &extra) {
+    cerr << "[VM] [Error]: " << message << extra << endl;
+    exit(-1);
+}
+
+void VM::run(const Program &program, vector<Value> &globals) {
+    // Slots above the stack pointer are always undefined: pops move values out.
+    stack.assign(STACK_SIZE, Value());
+    frames.clear();
+    const Value *constants = program.constants.data();
+    const Function *function = &program.functions[0];
+    const Instruction *code = function->code.data();
+    const Instruction *pc = code;
+    Value *base = stack.data();
+    Value *sp = base + function->numLocals;
+    Value *limit = stack.data() + stack.size() - STACK_RESERVE;
+    while (true) {
+        const Instruction &instruction = *pc++;
+        switch (instruction.op) {
+            case OP_CONSTANT:
+                *sp++ = constants[instruction.a];
+                break;
+            case OP_UNDEFINED:
+                sp++;
+                break;
+            case OP_POP:
+                *--sp = Value();
+                break;
+            case OP_LOAD_LOCAL:
+                *sp++ = base[instruction.a];
+                break;
+            case OP_STORE_LOCAL:
+                base[instruction.a] = std::move(*--sp);
+                break;
+            case OP_CLEAR_LOCALS:
+                for (Value *local = base + instruction.a; local < base + instruction.a + instruction.b; ++local) {
+                    *local = Value();
+                }
+                break;
+            case OP_LOAD_GLOBAL:
+                *sp++ = globals[instruction.a];
+                break;
+            case OP_STORE_GLOBAL:
+                globals[instruction.a] = std::move(*--sp);
+                break;
+            case OP_NEW_ARRAY: {
+                vector<Value> elements;
+                elements.reserve(instruction.a);
+                for (Value *element = sp - instruction.a; element < sp; ++element) {
+                    elements.push_back(std::move(*element));
+                }
+                sp -= instruction.a;
+                *sp++ = Collector::newArray(std::move(elements));
+                break;
+            }
+            case OP_LOAD_ELEMENT: {
+                Value &array = sp[-2];
+                if (!array.isArray()) error("not an array: ", array.toString());
+                const vector<Value> &elements = array.getArray()->elements();
+                size_t i = elements.size(); // Past the end unless the index selects an element.
+                if (sp[-1].getType() == Value::INT) {
+                    if (sp[-1].getInt() >= 0 && (uint64_t) sp[-1].getInt() < elements.size()) i = (size_t) sp[-1].getInt();
+                } else {
+                    double index = sp[-1].toReal();
+                    if (index >= 0 && index < elements.size()) i = (size_t) index;
+                }
+                sp[-1] = Value();
+                array = i < elements.size() ? elements[i] : Value();
+                sp--;
+                break;
+            }
+            case OP_STORE_ELEMENT: {
+                Value &array = sp[-3];
+                if (!array.isArray()) error("not an array: ", array.toString());
+                vector<Value> &elements = array.getArray()->mutableElements();
+                bool isStored; // Like reads, negative and non-numeric indexes select no element.
+                size_t i;
+                if (sp[-2].getType() == Value::INT) {
+                    isStored = sp[-2].getInt() >= 0;
+                    i = (size_t) sp[-2].getInt();
+                } else {
+                    double index = sp[-2].toReal();
+                    isStored = index >= 0 && index != INFINITY;
+                    i = isStored && index < Array::MAX_SIZE ? (size_t) index : Array::MAX_SIZE;
+                }
+                if (isStored) {
+                    if (i >= Array::MAX_SIZE) error("array index too large: ", sp[-2].toString());
+                    if (i >= elements.size()) elements.resize(i + 1);
+                    elements[i] = std::move(sp[-1]);
+                }
+                sp[-1] = Value();
+                sp[-2] = Value();
+                array = Value();
+                sp -= 3;
+                break;
+            }
+            case OP_ADD:
+                if (bothIntegers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::addIntegers(sp[-2].getInt(), sp[-1].getInt());
+                } else if (bothNumbers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::real(number(sp[-2]) + number(sp[-1]));
+                } else {
+                    sp[-2] = Value::add(sp[-2], sp[-1]);
+                }
+                *--sp = Value();
+                break;
+            case OP_SUBTRACT:
+                if (bothIntegers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::subtractIntegers(sp[-2].getInt(), sp[-1].getInt());
+                } else if (bothNumbers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::real(number(sp[-2]) - number(sp[-1]));
+                } else {
+                    sp[-2] = Value::subtract(sp[-2], sp[-1]);
+                }
+                *--sp = Value();
+                break;
+            case OP_MULTIPLY:
+                if (bothIntegers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::multiplyIntegers(sp[-2].getInt(), sp[-1].getInt());
+                } else if (bothNumbers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::real(number(sp[-2]) * number(sp[-1]));
+                } else {
+                    sp[-2] = Value::multiply(sp[-2], sp[-1]);
+                }
+                *--sp = Value();
+                break;
+            case OP_DIVIDE:
+                sp[-2] = Value::divide(sp[-2], sp[-1]);
+                *--sp = Value();
+                break;
+            case OP_MODULO:
+                sp[-2] = Value::modulo(sp[-2], sp[-1]);
+                *--sp = Value();
+                break;
+            case OP_LESS:
+                if (bothIntegers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::boolean(sp[-2].getInt() < sp[-1].getInt());
+                } else if (bothNumbers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::boolean(number(sp[-2]) < number(sp[-1]));
+                } else {
+                    sp[-2] = Value::boolean(Value::less(sp[-2], sp[-1]));
+                }
+                *--sp = Value();
+                break;
+            case OP_LESS_EQUAL:
+                if (bothIntegers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::boolean(sp[-2].getInt() <= sp[-1].getInt());
+                } else if (bothNumbers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::boolean(number(sp[-2]) <= number(sp[-1]));
+                } else {
+                    sp[-2] = Value::boolean(Value::lessEqual(sp[-2], sp[-1]));
+                }
+                *--sp = Value();
+                break;
+            case OP_GREATER:
+                if (bothIntegers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::boolean(sp[-2].getInt() > sp[-1].getInt());
+                } else if (bothNumbers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::boolean(number(sp[-2]) > number(sp[-1]));
+                } else {
+                    sp[-2] = Value::boolean(Value::less(sp[-1], sp[-2]));
+                }
+                *--sp = Value();
+                break;
+            case OP_GREATER_EQUAL:
+                if (bothIntegers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::boolean(sp[-2].getInt() >= sp[-1].getInt());
+                } else if (bothNumbers(sp[-2], sp[-1])) {
+                    sp[-2] = Value::boolean(number(sp[-2]) >= number(sp[-1]));
+                } else {
+                    sp[-2] = Value::boolean(Value::lessEqual(sp[-1], sp[-2]));
+                }
+                *--sp = Value();
+                break;
+            case OP_EQUAL:
+                sp[-2] = Value::boolean(Value::equals(sp[-2], sp[-1]));
+                *--sp = Value();
+                break;
+            case OP_NOT_EQUAL:
+                sp[-2] = Value::boolean(!Value::equals(sp[-2], sp[-1]));
+                *--sp = Value();
+                break;
+            case OP_NEGATE:
+                sp[-1] = Value::negate(sp[-1]);
+                break;
+            case OP_JUMP:
+                pc = code + instruction.a;
+                break;
+            case OP_JUMP_IF_FALSE: {
+                bool condition = sp[-1].getType() == Value::BOOL ? sp[-1].getBool() : sp[-1].toBool();
+                *--sp = Value();
+                if (!condition) pc = code + instruction.a;
+                break;
+            }
+            case OP_CALL: {
+                const Function *callee = &program.functions[instruction.a];
+                Value *arguments = sp - instruction.b;
+                // Arrays are passed by value.
+                for (Value *argument = arguments; argument < sp; ++argument) {
+                    if (argument->isArray()) *argument = Interpreter::copyArray(*argument);
+                }
+                if (arguments + callee->numLocals >= limit) error("stack overflow in ", callee->name);
+                frames.push_back({function, pc, base});
+                function = callee;
+                code = function->code.data();
+                pc = code;
+                base = arguments;
+                sp = base + function->numLocals;
+                break;
+            }
+            case OP_TAIL_CALL: {
+                const Function *callee = &program.functions[instruction.a];
+                Value *arguments = sp - instruction.b;
+                for (Value *argument = arguments; argument < sp; ++argument) {
+                    if (argument->isArray()) *argument = Interpreter::copyArray(*argument);
+                }
+                if (base + callee->numLocals >= limit) error("stack overflow in ", callee->name);
+                // The arguments move down over the current frame, the caller stays the same.
+                if (arguments != base) {
+                    for (int i = 0; i < instruction.b; ++i) base[i] = std::move(arguments[i]);
+                }
+                while (sp > base + instruction.b) *--sp = Value();
+                function = callee;
+                code = function->code.data();
+                pc = code;
+                sp = base + function->numLocals;
+                break;
+            }
+            case OP_INPUT:
+                *sp++ = Value::string(Interpreter::input());
+                break;
+            case OP_OUTPUT:
+                Interpreter::output(sp[-1]);
+                sp[-1] = Value();
+                break;
+            case OP_RETURN: {
+                Value result = std::move(*--sp);
+                while (sp > base) *--sp = Value();
+                CallFrame &caller = frames.back();
+                function = caller.function;
+                code = function->code.data();
+                pc = caller.returnAddress;
+                base = caller.base;
+                frames.pop_back();
+                *sp++ = std::move(result);
+                break;
+            }
+            case OP_HALT:
+                while (sp > base) *--sp = Value();
+                return;
+            default:
+                error("unexpected instruction: ", to_string(instruction.op));
+        }
+    }
+}
@@ -0,0 +1,171 @@
+#include "Value.h"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
+using namespace std;
+
+Value Value::string(const std::string &s) {
+    Value value;
+    value.type = STRING;
+    value.as.s = new StringObject{1, s};
+    return value;
+}
+
+Value Value::array(Array *array) {
+    Value value;
+    value.type = ARRAY;
+    value.as.a = array;
+    array->refs++;
+    return value;
+}
+
+const std::string &Value::getString() const {
+    return as.s->data;
+}
+
+bool Value::toBool() const {
+    switch (type) {
+        case BOOL:
+            return as.b;
+        case INT:
+            return as.i != 0;
+        case REAL:
+            return as.d != 0 && !std::isnan(as.d);
+        case STRING:
+            return !as.s->data.empty();
+        case ARRAY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+double Value::toReal() const {
+    switch (type) {
+        case BOOL:
+            return as.b ? 1 : 0;
+        case INT:
+            return (double) as.i;
+        case REAL:
+            return as.d;
+        case STRING: {
+            const std::string &str = as.s->data;
+            if (str.empty()) return 0;
+            char *end = nullptr;
+            double result = strtod(str.c_str(), &end);
+            return *end == '\0' ? result : NAN;
+        }
+        default:
+            return NAN;
+    }
+}
+
+// Same digits as to_string, i.e. printf's "%f", without going through the locale and vsnprintf.
+static std::string formatReal(double d) {
+    char buffer[320]; // Enough for the largest double with six decimals.
+    auto result = to_chars(buffer, buffer + sizeof buffer, d, chars_format::fixed, 6);
+    return std::string(buffer, result.ptr);
+}
+
+std::string Value::toString() const {
+    switch (type) {
+        case BOOL:
+            return as.b ? "true" : "false";
+        case INT:
+            return to_string(as.i);
+        case REAL:
+            if (std::isnan(as.d)) return "NaN";
+            if (std::isinf(as.d)) return as.d > 0 ? "Infinity" : "-Infinity";
+            return formatReal(as.d);
+        case STRING:
+            return as.s->data;
+        case ARRAY: {
+            // Arrays may contain themselves, print those references as "[...]".
+            static std::vector<const Array *> printing;
+            for (const Array *outer : printing) {
+                if (outer == as.a) return "[...]";
+            }
+            printing.push_back(as.a);
+            std::string result = "[";
+            const std::vector<Value> &elements = as.a->elements();
+            for (size_t i = 0; i < elements.size(); ++i) {
+                if (i > 0) result += ", ";
+                result += elements[i].toString();
+            }
+            printing.pop_back();
+            return result + "]";
+        }
+        default:
+            return "undefined";
+    }
+}
+
+Value Value::add(const Value &left, const Value &right) {
+    if (left.type == INT && right.type == INT) return addIntegers(left.as.i, right.as.i);
+    if (left.isString() || right.isString()) {
+        return string(left.toString() + right.toString());
+    }
+    return real(left.toReal() + right.toReal());
+}
+
+Value Value::subtract(const Value &left, const Value &right) {
+    if (left.type == INT && right.type == INT) return subtractIntegers(left.as.i, right.as.i);
+    return real(left.toReal() - right.toReal());
+}
+
+Value Value::multiply(const Value &left, const Value &right) {
+    if (left.type == INT && right.type == INT) return multiplyIntegers(left.as.i, right.as.i);
+    return real(left.toReal() * right.toReal());
+}
+
+Value Value::divide(const Value &left, const Value &right) {
+    if (left.type == INT && right.type == INT) return divideIntegers(left.as.i, right.as.i);
+    return real(left.toReal() / right.toReal());
+}
+
+Value Value::modulo(const Value &left, const Value &right) {
+    if (left.type == INT && right.type == INT) return moduloIntegers(left.as.i, right.as.i);
+    return real(fmod(left.toReal(), right.toReal()));
+}
+
+Value Value::negate(const Value &value) {
+    if (value.type == INT && value.as.i != INT64_MIN) {
+        return integer(-value.as.i);
+    }
+    return real(-value.toReal());
+}
+
+// Loose equality: strings compare by content, arrays by identity, undefined only
+// equals undefined, everything else compares numerically: integers exactly.
+bool Value::equals(const Value &left, const Value &right) {
+    if (left.type == INT && right.type == INT) return left.as.i == right.as.i;
+    if (left.type == right.type && left.type == STRING) {
+        return left.as.s->data == right.as.s->data;
+    }
+    if (left.type == ARRAY || right.type == ARRAY) {
+        return left.type == right.type && left.as.a == right.as.a;
+    }
+    if (left.type == UNDEFINED || right.type == UNDEFINED) {
+        return left.type == right.type;
+    }
+    return left.toReal() == right.toReal();
+}
+
+// Strings compare lexicographically, everything else numerically. `a > b` is `less(b, a)`.
+bool Value::less(const Value &left, const Value &right) {
+    if (left.type == INT && right.type == INT) return left.as.i < right.as.i;
+    if (left.type == STRING && right.type == STRING) {
+        return left.as.s->data < right.as.s->data;
+    }
+    return left.toReal() < right.toReal();
+}
+
+bool Value::lessEqual(const Value &left, const Value &right) {
+    if (left.type == INT && right.type == INT) return left.as.i <= right.as.i;
+    if (left.type == STRING && right.type == STRING) {
+        return left.as.s->data <= right.as.s->data;
+    }
+    return left.toReal() <= right.toReal();
+}
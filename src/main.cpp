@@ -1,4 +1,5 @@
 #include "Interpreter.h"
+#include "IO.h"
 #include <iostream>
 #include <cstring>
 
@@ -6,12 +7,44 @@ using namespace std;
 
 int main(int argc, char *argv[]) {
     Interpreter interpreter;
-    if (argc == 1) {
-        interpreter.shell();
+    string filename;
+    bool unbuffered = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "-d", 2) == 0) {
+            interpreter.setDebugMode(true);
+        } else if (strcmp(argv[i], "--engine=vm") == 0) {
+            interpreter.setEngine(Interpreter::BYTECODE_VM);
+        } else if (strcmp(argv[i], "--engine=ast") == 0) {
+            interpreter.setEngine(Interpreter::TREE_WALKER);
+        } else if (strcmp(argv[i], "--gc-stats") == 0) {
+            interpreter.setGcStats(true);
+        } else if (strcmp(argv[i], "-O0") == 0 || strcmp(argv[i], "-O1") == 0) {
+            interpreter.setOptimizationLevel(argv[i][2] - '0');
+        } else if (strcmp(argv[i], "--unbuffered") == 0) {
+            unbuffered = true;
+        } else if (strcmp(argv[i], "--memoize") == 0) {
+            interpreter.setMemoize(true);
+        } else if (strncmp(argv[i], "--profile=", 10) == 0) {
+            interpreter.setProfileFile(argv[i] + 10);
+        } else if (strcmp(argv[i], "--jit") == 0) {
+            interpreter.setJit(100);
+        } else if (strncmp(argv[i], "--jit-threshold=", 16) == 0) {
+            interpreter.setJit(atoi(argv[i] + 16));
+        } else if (strcmp(argv[i], "--jit-stats") == 0) {
+            interpreter.setJitStats(true);
+        } else if (strncmp(argv[i], "--cache=", 8) == 0) {
+            interpreter.setCacheDirectory(argv[i] + 8);
+        } else if (filename.empty()) {
+            filename = argv[i];
+        } else {
+            cerr << "usage: " << argv[0] << " [<*.js> [-d] [--engine=ast|vm] [--gc-stats] [--cache=<dir>] [-O0|-O1] [--memoize] [--unbuffered] [--profile=<file>] [--jit] [--jit-threshold=<n>] [--jit-stats]]" << endl;
+            exit(-1);
+        }
     }
-    if (argc >=3 && strncmp(argv[2], "-d", 2) == 0) {
-        interpreter.setDebugMode(true);
+    IO::init(unbuffered);
+    if (filename.empty()) {
+        interpreter.shell();
+        return 0;
     }
-    string filename(argv[1]);
     interpreter.interpretFile(filename);
 }
@@ -1,14 +1,61 @@
 #include "Lexer.h"
+#include "Scanner.h"
+#include <chrono>
+#include <cstring>
 #include <iostream>
 
 using namespace std;
 
+// Lex the whole file a few times and report the best throughput.
+static void benchmark(const string &filename) {
+    const int runs = 5;
+    double best = 0;
+    size_t tokens = 0;
+    MappedFile file;
+    file.open(filename);
+    for (int run = 0; run < runs; ++run) {
+        Lexer lexer;
+        lexer.openFile(filename);
+        tokens = 0;
+        auto start = chrono::steady_clock::now();
+        for (Lexer::Token token = lexer.nextToken(); token.type != Lexer::END_OF_FILE; token = lexer.nextToken()) {
+            tokens++;
+        }
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < best) best = elapsed.count();
+    }
+    cout << "mode: " << Scanner::modeName(Scanner::getMode()) << endl;
+    cout << "tokens: " << tokens << ", bytes: " << file.size() << endl;
+    cout << "best of " << runs << ": " << best * 1000 << " ms, "
+         << (size_t) (tokens / best) << " tokens/s, "
+         << file.size() / best / (1 << 20) << " MiB/s" << endl;
+}
+
 int main(int argc, char *argv[]) {
-    if(argc < 2) {
-        cerr << "usage: " << argv[0] << " <*.js>" <<endl;
+    string filename;
+    bool bench = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--scalar") == 0) {
+            Scanner::setMode(Scanner::SCALAR);
+        } else if (strcmp(argv[i], "--sse2") == 0) {
+            Scanner::setMode(Scanner::SSE2);
+        } else if (filename.empty()) {
+            filename = argv[i];
+        } else {
+            filename.clear();
+            break;
+        }
+    }
+    if (filename.empty()) {
+        cerr << "usage: " << argv[0] << " [--bench [--scalar|--sse2]] <*.js>" << endl;
         exit(-1);
     }
-    string filename(argv[1]);
+    if (bench) {
+        benchmark(filename);
+        return 0;
+    }
     Lexer lexer;
     lexer.openFile(filename);
     Lexer::Token token = lexer.nextToken();
@@ -16,4 +63,4 @@ int main(int argc, char *argv[]) {
         lexer.print(token);
         token = lexer.nextToken();
     }
-}
\ No newline at end of file
+}
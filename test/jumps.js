@@ -0,0 +1,56 @@
+let calls = 0;
+
+function touch(result) {
+    calls = calls + 1;
+    return result;
+}
+
+let andSkipped = false && touch(true);
+let orSkipped = true || touch(false);
+let andRuns = true && touch(true);
+let orRuns = false || touch(false);
+let chained = (1 < 2) && ((3 > 4) || touch(true));
+
+let sum = 0;
+for (let i = 0; i < 10; i = i + 1) {
+    if (i % 2 == 0) {
+        continue;
+    }
+    if (i > 7) {
+        break;
+    }
+    sum = sum + i;
+}
+
+let pairs = 0;
+let outer = 0;
+while (outer < 5) {
+    outer = outer + 1;
+    if (outer == 2) {
+        continue;
+    }
+    for (let inner = 0; inner < 5; inner = inner + 1) {
+        if (inner == outer) {
+            break;
+        }
+        if (inner == 1) {
+            continue;
+        }
+        pairs = pairs + 1;
+    }
+    if (outer == 4) {
+        break;
+    }
+}
+
+function firstAbove(limit) {
+    let n = 0;
+    while (true) {
+        n = n + 1;
+        if (n * n > limit) {
+            return n;
+        }
+    }
+}
+
+let found = firstAbove(50);
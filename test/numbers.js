@@ -0,0 +1,36 @@
+let big = 4611686018427387904;
+let max = big - 1 + big;
+let wrapped = max + 1;
+let product = big * 4;
+let negated = 0 - max - 1;
+let flipped = 0 - negated;
+
+let exact = 12 / 4;
+let inexact = 7 / 2;
+let negativeExact = 0 - 12 / 4;
+let byMinusOne = negated / (0 - 1);
+let remainder = 0 - 7 % 3;
+let byZero = 7 % 0;
+let infinite = 7 / 0;
+
+let counter = max - 150;
+let halves = 0;
+let evens = 0;
+for (let i = 0; i < 300; i = i + 1) {
+    counter = counter + 1;
+    halves = halves + i / 2;
+    evens = evens + (i * 2) / 2;
+}
+
+let a = [1, 2];
+a[0 - 1] = 9;
+a[0 - 2.5] = 8;
+a[0 / 0] = 6;
+a[3] = 5;
+a[1.5] = 4;
+let first = a[0];
+let second = a[1];
+let gap = a[2];
+let grown = a[3];
+let farRead = a[4294967296];
+let negativeRead = a[0 - 1];
@@ -0,0 +1,15 @@
+let calls = 0;
+let a = [1, 2, 3];
+
+function replace(index) {
+    a = [7];
+    calls = calls + 1;
+    return index;
+}
+
+let read = a[replace(1)];
+a = [1, 2, 3];
+let b = a;
+a[replace(2)] = 9;
+let stored = b[2];
+let kept = a[0];
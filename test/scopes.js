@@ -0,0 +1,21 @@
+let x = 1;
+let i = 0;
+while (i < 3) {
+    output(x);
+    if (i == 0) {
+        let x = 5;
+    }
+    output(x);
+    i = i + 1;
+}
+
+for (let j = 0; j < 3; j = j + 1) {
+    output(y);
+    let y = j * 10;
+    for (let k = 0; k < 2; k = k + 1) {
+        output(z);
+        if (k == 0) {
+            let z = y + k;
+        }
+    }
+}